@@ -11,6 +11,8 @@
 #include <IqrfSpiChannel.h>
 #include <IqrfFakeChannel.h>
 #include <TrIfc.h>
+#include <TrJob.h>
+#include <TrPlanner.h>
 #include <IqrfLogging.h>
 #include <programtr_cmd.h>
 
@@ -34,27 +36,46 @@ IChannel * getInterface(std::string interface, std::string dev) {
 }
 
 
+void getJob(Commands& cmd, TrJob& job) {
+    if (cmd.programTrconf()) {
+        job.setTrconf(cmd.getTrconf());
+    }
+    
+    if (cmd.programHex()) {
+        job.addHex(cmd.getTarget(), cmd.getHex());
+    }
+    
+    if (cmd.programIqrf()) {
+        job.setIqrf(cmd.getIqrf());
+    }
+}
+
+void planTr(Commands& cmd) {
+    TrJob job;
+    // Without TR the plan is made for PIC16F1938 based DCTR-5xD
+    TrPlanner planner(*getTrMemoryMap(TrMcu::PIC16F1938, TrSerie::DCTR_5xD));
+    TrChannelType type = (cmd.getInterface() == "spi") ? TrChannelType::SPI : TrChannelType::CDC;
+    
+    getJob(cmd, job);
+    
+    try {
+        TrPlan plan = planner.plan(job);
+        std::cout << "Transactions: " << plan.size() << "\n";
+        std::cout << "Estimated time: " << plan.estimate(TrLatencyModel::getDefault(type)) << " s\n";
+    } catch (std::exception& e) {
+        std::cout << "Standard exception: " << e.what() << std::endl;
+    }
+}
+
 void programTr(IChannel * channel, Commands& cmd) {
     TrIfc ifc(channel);
-    std::basic_string<unsigned char> data;
-    unsigned char val;
+    TrJob job;
     
-    ifc.enterProgrammingMode();
+    getJob(cmd, job);
     
     try {
-        if (cmd.programTrconf()) {
-            ifc.uploadCfg(cmd.getTrconf());
-        }
-        
-        if (cmd.programHex()) {
-            ifc.uploadHex(cmd.getTarget(), cmd.getHex());
-        }
-        
-        if (cmd.programIqrf()) {
-            ifc.uploadIqrf(cmd.getIqrf());
-        }
-        
-        ifc.terminateProgrammingMode();
+        // All files are checked before TR enters programming mode
+        ifc.uploadJob(job);
     } catch (std::exception& e) {
         std::cout << "Standard exception: " << e.what() << std::endl;
         ifc.terminateProgrammingMode();
@@ -62,7 +83,7 @@ void programTr(IChannel * channel, Commands& cmd) {
 }
 
 void help(void) {
-    std::cout << "programtr -i <interface> -d <dev> [-c <trconf> | -p <hex> -t <target> | -q <iqrf> ] \n";
+    std::cout << "programtr -i <interface> -d <dev> [-c <trconf> | -p <hex> -t <target> | -q <iqrf> ] [-n]\n";
     std::cout << "Program TR connected to specified interface.\n";
     std::cout << "Parameters:\n";
     std::cout << "-i <interface> - interface for communication with TR. Supported interfaces are:\n";
@@ -77,6 +98,8 @@ void help(void) {
     std::cout << "                   internal - internal eeprom memory\n";
     std::cout << "                   external - external eeprom memory\n";
     std::cout << "-q <hex>       - program TR with IQRF programming file <iqrf>\n";
+    std::cout << "-n             - dry run, print planned transactions and estimated time,\n";
+    std::cout << "                 TR is not touched and -d is not required\n";
 }
 
 int main (int argc, char * argv[]) {
@@ -87,6 +110,11 @@ int main (int argc, char * argv[]) {
         exit(1);
     }
     
+    if (cmd.dryRun()) {
+        planTr(cmd);
+        exit(0);
+    }
+    
     TRC_START("log.txt", Level::dbg, 1000000);
     TRC_ENTER("");
 
@@ -23,7 +23,7 @@
 #include <TrIfc.h>
 #include <programtr_cmd.h>
 
-const char * PARAMS = "i:d:c:p:t:q:";
+const char * PARAMS = "i:d:c:p:t:q:n";
 
 static TrMemory parseTarget(std::string val) {
     if (val == "flash")
@@ -117,6 +117,14 @@ void Commands::parse(int argc, char * argv[]) {
 	);
 	cmd.add(iqrfProgFileArg);
 
+	TCLAP::SwitchArg dryRunArg(
+	  "n",
+	  "dry_run",
+	  "print planned transactions and estimated time without programming TR",
+	  false
+	);
+	cmd.add(dryRunArg);
+
 
 	// Parse the argv array.
 	cmd.parse(argc, argv);
@@ -163,6 +171,8 @@ void Commands::parse(int argc, char * argv[]) {
 	  isIqrf = true;
 	}
 
+	isDryRun = dryRunArg.getValue();
+
   } catch (TCLAP::ArgException &e) {
 	  std::cerr << "Error while parsing commandline parameters!\n";
 	  valid = false;
@@ -190,7 +200,7 @@ void Commands::parse(int argc, char * argv[]) {
 	valid = false;
   }
 
-  if (!isDev) {
+  if (!isDev && !isDryRun) {
 	std::cerr << "Configuration option -d must be specified!\n";
 	valid = false;
   }
@@ -237,6 +247,9 @@ void Commands::parse(int argc, char * argv[]) {
             iqrf = optarg;
             isIqrf = true;
             break;
+        case 'n':
+            isDryRun = true;
+            break;
         case '?':
             if (optopt == 'i' || optopt == 'd' || optopt == 'c' || optopt == 'p' || optopt == 't' || optopt == 'q') {
                 std::cerr << "Option -" << static_cast<char>(optopt) << " requires an argument.\n";
@@ -274,7 +287,7 @@ void Commands::parse(int argc, char * argv[]) {
         valid = false;
     }
     
-    if (!isDev) {
+    if (!isDev && !isDryRun) {
         std::cerr << "Configuration option -d must be specified!\n";
         valid = false;
     }
@@ -286,6 +299,7 @@ Commands::Commands(int argc, char * argv[]) {
     isHex = false;
     isIqrf = false;
     isTrconf = false;
+    isDryRun = false;
     valid = false;
     parsed = false;
     
@@ -371,3 +385,11 @@ std::string Commands::getIqrf(void) {
         throw std::runtime_error("Can not get nonexistent file name of IQRF file!");
     }
 }
+
+bool Commands::dryRun(void) {
+    if (isValid() && isDryRun) {
+        return true;
+    } else {
+        return false;
+    }
+}
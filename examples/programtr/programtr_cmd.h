@@ -21,6 +21,7 @@ private:
     bool isHex;
     bool isIqrf;
     bool isTrconf;
+    bool isDryRun;
     bool valid;
     bool parsed;
     
@@ -37,6 +38,7 @@ public:
     TrMemory getTarget(void);
     bool programIqrf(void);
     std::string getIqrf(void);
+    bool dryRun(void);
 };
 
 #endif // __PROGRAMTR_CMD_H__
@@ -106,6 +106,8 @@ void runTest(IChannel * channel) {
         ifc.downloadHex(TrMemory::INTERNAL_EEPROM, 0, 0x00a0, "internal.hex");
         ifc.downloadHex(TrMemory::EXTERNAL_EEPROM, 0, 0x7fe0, "external.hex");
         
+        ifc.snapshot("snapshot.trsn");
+        
         ifc.terminateProgrammingMode();
     } catch (std::exception& e) {
         std::cout << "Standard exception: " << e.what() << std::endl;
@@ -0,0 +1,96 @@
+/*
+ * Example application for clibtr - compare TR memory images.
+ * Author: Vlastimil Kosar <kosar@rehivetech.com>
+ * License: TBD
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <iomanip>
+
+#include <TrDiff.h>
+#include <TrSnapshot.h>
+#include <HexFmtParser.h>
+
+bool getMemory(std::string name, TrMemory& memory) {
+    if (name == "flash") {
+        memory = TrMemory::FLASH;
+    } else if (name == "internal") {
+        memory = TrMemory::INTERNAL_EEPROM;
+    } else if (name == "external") {
+        memory = TrMemory::EXTERNAL_EEPROM;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool isSnapshot(const std::string& name) {
+    return (name.length() > 5) && (name.compare(name.length() - 5, 5, ".trsn") == 0);
+}
+
+void loadImage(std::string name, TrDiffImage& image) {
+    if (isSnapshot(name)) {
+        TrSnapshot snapshot;
+        snapshot.load(name);
+        image.addSnapshot(snapshot);
+    } else {
+        HexFmtParser parser(image.getMemory(), name);
+        parser.parse();
+        image.addHex(parser);
+    }
+}
+
+void printBlock(const std::string& comment, const unsigned char* data, uint32_t mask) {
+    std::cout << comment;
+    for (size_t i = 0; i < TR_DIFF_BLOCK_LEN; i++) {
+        if ((mask >> i) & 1) {
+            std::cout << std::setw(2) << std::setfill('0') << std::hex << static_cast<int>(data[i]) << " ";
+        } else {
+            std::cout << ".. ";
+        }
+    }
+    std::cout << std::endl;
+}
+
+int main (int argc, char * argv[]) {
+    TrMemory memory;
+
+    if ((argc != 4) || !getMemory(argv[1], memory)) {
+        std::cout << "trdiff <memory> <old> <new>\n";
+        std::cout << "Compare two images of TR memory block by block.\n";
+        std::cout << "Parameters:\n";
+        std::cout << "<memory> - compared memory: flash, internal or external eeprom\n";
+        std::cout << "<old>    - HEX file or snapshot file (.trsn)\n";
+        std::cout << "<new>    - HEX file or snapshot file (.trsn)\n";
+        std::cout << "Bytes not present in HEX file are compared as erased. Exit status is 0 if the\n";
+        std::cout << "images are equal, 1 if they differ and 2 if an image can not be read.\n";
+        exit(2);
+    }
+
+    TrDiffImage first(memory);
+    TrDiffImage second(memory);
+    std::vector<TrDiffBlock> diffs;
+    std::vector<TrDiffBlock>::iterator itr;
+
+    try {
+        loadImage(argv[2], first);
+        loadImage(argv[3], second);
+    } catch (std::exception& e) {
+        std::cerr << "Standard exception: " << e.what() << std::endl;
+        exit(2);
+    }
+
+    diffTrImages(first, second, diffs);
+
+    for (itr = diffs.begin(); itr != diffs.end(); itr++) {
+        size_t block = (*itr).addr / TR_DIFF_BLOCK_LEN;
+        std::cout << std::setw(6) << std::setfill('0') << std::hex << (*itr).addr << ":" << std::endl;
+        printBlock("  - ", first.getBlock(block), (*itr).mask);
+        printBlock("  + ", second.getBlock(block), (*itr).mask);
+    }
+
+    std::cout << std::dec << diffs.size() << " blocks differ." << std::endl;
+    return diffs.empty() ? 0 : 1;
+}
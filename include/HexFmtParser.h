@@ -10,8 +10,11 @@
 #include <vector>
 #include <string>
 #include <array>
+#include <fstream>
+#include <cstdint>
 
 #include <TrTypes.h>
+#include <TrListener.h>
 
 struct HexDataRecord {
     unsigned int addr;
@@ -24,15 +27,44 @@ private:
     std::string file_name;
     std::vector<HexDataRecord> blines;
     TrMemory memory;
+    TrListener* listener;
+    std::vector<TrNote> notes;
+
+    // Parse without reporting notes
+    void parseFile();
 public:
-    HexFmtParser(TrMemory memory, std::string name) : memory(memory), file_name(name) {}
+    HexFmtParser(TrMemory memory, std::string name) : memory(memory), file_name(name), listener(nullptr) {}
     void parse();
+    // Listener of notes and warnings, without listener they are written to std::cerr
+    void setListener(TrListener* l) { listener = l; }
+    const std::vector<TrNote>& getNotes() const { return notes; }
     typedef std::vector<HexDataRecord>::iterator iterator;
     typedef std::vector<HexDataRecord>::const_iterator const_iterator;
     iterator begin() { return blines.begin(); }
     iterator end() { return blines.end(); }
     void pushBack(unsigned int addr, std::basic_string<unsigned char> data);
+    /*
+     * Add records of 16b little endian fill pattern for parts of range
+     * [addr, addr + len) not covered by any record, e.g. erased blocks elided
+     * by TrIfc::downloadHex, see getTrFillPattern. Records are sorted by
+     * address, added records do not cross boundaries of 32B blocks from addr.
+     */
+    void fill(unsigned int addr, size_t len, uint16_t pattern);
     void save();
 };
 
+// Writes file in hex format record by record
+class HexFmtWriter {
+private:
+    std::string file_name;
+    std::ofstream outfile;
+    int line_no;
+    std::string line;
+public:
+    HexFmtWriter(std::string name) : file_name(name), outfile(name), line_no(0) {}
+    void write(unsigned int addr, const std::basic_string<unsigned char>& data);
+    // Write end of file record
+    void close();
+};
+
 #endif // __HEXFMTPARSER_H__
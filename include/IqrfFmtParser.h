@@ -12,6 +12,8 @@
 #include <array>
 #include <map>
 #include <TrTypes.h>
+#include <TrListener.h>
+#include <TrError.h>
 
 class IqrfPrgHeader {
 private:
@@ -21,8 +23,15 @@ private:
     std::map<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>> supportedOs;
 public:
     IqrfPrgHeader() {index = 0; mcu = TrMcu::NONE; serie = TrSerie::NONE;}
-    void add(std::string line);
-    bool check(TrModuleInfo& info);
+    // Header stored outside of IQRF file
+    IqrfPrgHeader(TrMcu m, TrSerie s, const std::map<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>>& os) : index(2), mcu(m), serie(s), supportedOs(os) {}
+    void add(const std::string& line, std::vector<TrNote>& notes, const std::string& file, size_t line_no);
+    bool check(TrModuleInfo& info) {return validate(info).isOk();}
+    // Check of TR type and OS without exceptions
+    TrError validate(const TrModuleInfo& info) const;
+    TrMcu getMcu() const {return mcu;}
+    TrSerie getSerie() const {return serie;}
+    const std::map<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>>& getSupportedOs() const {return supportedOs;}
 };
 
 class IqrfFmtParser {
@@ -30,10 +39,21 @@ private:
     std::string file_name;
     std::vector<std::basic_string<unsigned char>> blines;
     IqrfPrgHeader prgHeader;
+    TrListener* listener;
+    std::vector<TrNote> notes;
+
+    // Parse without reporting notes
+    void parseFile();
 public:
-    IqrfFmtParser(std::string name) : file_name(name) {}
+    IqrfFmtParser(std::string name) : file_name(name), listener(nullptr) {}
     void parse();
+    // Listener of notes and warnings, without listener they are written to std::cerr
+    void setListener(TrListener* l) { listener = l; }
+    const std::vector<TrNote>& getNotes() const { return notes; }
     bool check(TrModuleInfo& info) {return prgHeader.check(info);}
+    TrError validate(const TrModuleInfo& info) const {return prgHeader.validate(info);}
+    const IqrfPrgHeader& getPrgHeader() const {return prgHeader;}
+    std::string getFileName() const {return file_name;}
     typedef std::vector<std::basic_string<unsigned char>>::iterator iterator;
     typedef std::vector<std::basic_string<unsigned char>>::const_iterator const_iterator;
     iterator begin() { return blines.begin(); }
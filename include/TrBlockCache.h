@@ -0,0 +1,42 @@
+/*
+ * Cache of blocks downloaded from TR memory.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRBLOCKCACHE_H__
+#define __TRBLOCKCACHE_H__
+
+#include <map>
+#include <string>
+#include <utility>
+#include <cstdint>
+
+#include <TrTypes.h>
+
+/*
+ * Downloaded blocks keyed by target and byte address of the block. Uploads
+ * are written through into the cached blocks they overlap. Targets without
+ * address (configuration, RFPMG, RFBAND) use address 0.
+ */
+class TrBlockCache {
+private:
+    std::map<std::pair<TrTarget, unsigned int>, std::basic_string<unsigned char>> blocks;
+    uint64_t hits;
+    uint64_t misses;
+public:
+    TrBlockCache() : hits(0), misses(0) {}
+    // Cached block, returns false if the block is not cached
+    bool find(TrTarget target, unsigned int addr, std::basic_string<unsigned char>& data);
+    void store(TrTarget target, unsigned int addr, const std::basic_string<unsigned char>& data);
+    // Write uploaded data into overlapping cached blocks
+    void update(TrTarget target, unsigned int addr, const unsigned char* data, size_t len);
+    // Forget all blocks of the target
+    void invalidate(TrTarget target);
+    void clear() { blocks.clear(); }
+
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+};
+
+#endif // __TRBLOCKCACHE_H__
@@ -0,0 +1,48 @@
+/*
+ * Checkpoint journal of resumable TR programming sessions.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRCHECKPOINT_H__
+#define __TRCHECKPOINT_H__
+
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+// Kind of checkpointed image, IQRF uploads restart from the first record
+enum class TrCheckpointTarget : unsigned char {
+    NONE,
+    FLASH,
+    INTERNAL_EEPROM,
+    EXTERNAL_EEPROM
+};
+
+struct TrCheckpointData {
+    TrCheckpointTarget target;
+    uint64_t hash;      // Hash of the whole image
+    uint32_t blocks;    // Number of blocks of the image
+    uint32_t next;      // Index of the first not acknowledged block
+    TrCheckpointData() : target(TrCheckpointTarget::NONE), hash(0), blocks(0), next(0) {}
+};
+
+/*
+ * Small journal file rewritten in place after every acknowledged block.
+ * The journal is removed when the upload finishes.
+ */
+class TrCheckpoint {
+private:
+    std::string file_name;
+    std::fstream file;
+public:
+    TrCheckpoint(std::string name) : file_name(name) {}
+    // Load checkpoint, returns false if there is no valid checkpoint
+    bool load(TrCheckpointData& data);
+    // Write checkpoint
+    void save(const TrCheckpointData& data);
+    // Remove journal of finished upload
+    void remove();
+};
+
+#endif // __TRCHECKPOINT_H__
@@ -0,0 +1,85 @@
+/*
+ * Precompiled command stream of programming job.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRCOMMANDSTREAM_H__
+#define __TRCOMMANDSTREAM_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <TrTypes.h>
+#include <TrMemoryMap.h>
+#include <TrJob.h>
+#include <TrMessage.h>
+
+// Version of command stream format
+static const unsigned char TR_COMMAND_STREAM_VERSION = 1;
+
+enum class TrCommandOp {
+    ENTER_PRG_MODE = 1,
+    TERMINATE_PRG_MODE,
+    // Check TRCONF channels against RFBAND of TR, data is TRCONF configuration
+    CHECK_RFBAND,
+    // Check OS of TR against IQRF plugin, data is list of supported OS
+    CHECK_OS,
+    // Upload ready to send message
+    UPLOAD
+};
+
+struct TrCommand {
+    TrCommandOp op;
+    TrTarget target;
+    std::basic_string<unsigned char> data;
+    TrMessage msg;      // Message of upload built once, shared by all TRs
+    TrCommand(TrCommandOp o, TrTarget t, const std::basic_string<unsigned char>& d) : op(o), target(t), data(d) {
+        if (op == TrCommandOp::UPLOAD) {
+            msg = TrMessage(d);
+        }
+    }
+};
+
+/*
+ * Programming job compiled for one type of TR into a flat sequence of
+ * commands. All checks which do not need the TR are done by compile().
+ * Stored stream is versioned and hashed, the hash covers TR type and all
+ * commands and is checked by load().
+ */
+class TrCommandStream {
+private:
+    TrMcu mcu;
+    TrSerie serie;
+    std::vector<TrCommand> commands;
+    uint64_t hash;
+    std::string name;
+
+    void add(TrCommandOp op, TrTarget target, const std::basic_string<unsigned char>& data);
+    std::basic_string<unsigned char> serialize() const;
+public:
+    TrCommandStream() : mcu(TrMcu::NONE), serie(TrSerie::NONE), hash(0) {}
+
+    // Compile job for TR type of the memory map
+    void compile(TrJob& job, const TrMemoryMap& map);
+    // Load and save stream file, load throws exception if the file is damaged
+    void load(std::string name);
+    void save(std::string name) const;
+
+    TrMcu getMcu() const { return mcu; }
+    TrSerie getSerie() const { return serie; }
+    uint64_t getHash() const { return hash; }
+    // File name of loaded stream, empty for compiled stream
+    std::string getName() const { return name; }
+
+    // Check OS of TR against data of CHECK_OS command
+    static bool checkOs(const TrCommand& command, const TrModuleInfo& info);
+
+    typedef std::vector<TrCommand>::const_iterator const_iterator;
+    const_iterator begin() const { return commands.begin(); }
+    const_iterator end() const { return commands.end(); }
+    size_t size() const { return commands.size(); }
+};
+
+#endif // __TRCOMMANDSTREAM_H__
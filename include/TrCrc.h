@@ -0,0 +1,75 @@
+/*
+ * CRC32C fingerprints of TR memory images and blocks.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRCRC_H__
+#define __TRCRC_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <TrDiff.h>
+
+/*
+ * CRC32C (Castagnoli) of data continuing from crc, use 0 for a new
+ * computation. CPU instructions are used where available - SSE4.2 is
+ * detected at runtime, ARMv8 CRC at compile time.
+ */
+uint32_t crc32cTr(uint32_t crc, const unsigned char* data, size_t len);
+
+// True if crc32cTr is computed by CPU instructions
+bool isTrCrcAccelerated();
+
+// Streaming CRC32C, e.g. of blocks downloaded from TR as they arrive
+class TrCrc {
+private:
+    uint32_t state;
+public:
+    TrCrc() : state(0) {}
+    void update(const unsigned char* data, size_t len) { state = crc32cTr(state, data, len); }
+    void update(const std::basic_string<unsigned char>& data) { update(data.data(), data.size()); }
+    uint32_t digest() const { return state; }
+};
+
+// Digest of region [addr, end) of an image, addresses are HEX file addresses
+struct TrRegionDigest {
+    unsigned int addr;
+    unsigned int end;
+    uint32_t digest;
+    TrRegionDigest(unsigned int a, unsigned int e) : addr(a), end(e), digest(0) {}
+};
+
+/*
+ * Digests of blocks of TR_DIFF_BLOCK_LEN bytes, of regions and of the whole
+ * image, computed in one pass over the image. Region and image digests are
+ * CRC32C of the little endian digests of their blocks, so a changed block
+ * is found by comparing only the block digests of changed regions. Erased
+ * blocks at the end of the image are not part of it, images which differ
+ * only in their length of erased memory have the same digests.
+ */
+class TrImageDigest {
+private:
+    std::vector<uint32_t> blocks;
+    std::vector<TrRegionDigest> regions;
+    uint32_t image;
+    uint32_t erased;
+public:
+    TrImageDigest() : image(0), erased(0) {}
+
+    // Add region before compute, region must be aligned to blocks
+    void addRegion(unsigned int addr, unsigned int end);
+    // Compute all digests, regions beyond the end of the image cover erased blocks
+    void compute(const TrDiffImage& img);
+
+    uint32_t getImageDigest() const { return image; }
+    // Blocks up to the last block which is not erased
+    size_t getBlockCount() const { return blocks.size(); }
+    // Digest of erased block beyond the end of the image
+    uint32_t getBlockDigest(size_t block) const { return (block < blocks.size()) ? blocks[block] : erased; }
+    const std::vector<TrRegionDigest>& getRegions() const { return regions; }
+};
+
+#endif // __TRCRC_H__
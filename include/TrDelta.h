@@ -0,0 +1,72 @@
+/*
+ * Delta update package between two firmware versions.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRDELTA_H__
+#define __TRDELTA_H__
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include <TrTypes.h>
+#include <TrDiff.h>
+#include <IqrfFmtParser.h>
+
+// Changed block with its new content and hash of its old content, at HEX file address
+struct TrDeltaBlock {
+    unsigned int addr;
+    uint64_t preHash;
+    std::basic_string<unsigned char> data;
+    TrDeltaBlock(unsigned int a, uint64_t h, const std::basic_string<unsigned char>& d) : addr(a), preHash(h), data(d) {}
+};
+
+/*
+ * Changes of one memory. Pre-image are all blocks of the old image which
+ * are not erased together with the changed blocks, it is stored as runs of
+ * blocks - address and number of blocks. Post-image hash covers the blocks
+ * of the pre-image in order of addresses with the changed blocks replaced
+ * by their new content. Changed blocks are sorted by address.
+ */
+struct TrDeltaSection {
+    TrMemory memory;
+    std::vector<std::pair<unsigned int, unsigned int>> runs;
+    uint64_t postHash;
+    std::vector<TrDeltaBlock> blocks;
+    TrDeltaSection(TrMemory m) : memory(m), postHash(0) {}
+};
+
+/*
+ * Changed blocks of flash and external eeprom and the new IQRF plugin if
+ * it changed. Blocks are TR_DIFF_BLOCK_LEN long.
+ */
+class TrDelta {
+private:
+    std::vector<TrDeltaSection> sections;
+    bool iqrf;
+    IqrfPrgHeader prgHeader;
+    std::vector<std::basic_string<unsigned char>> records;
+public:
+    TrDelta() : iqrf(false) {}
+
+    // Add changes between images of one memory, flash or external eeprom
+    void addImages(const TrDiffImage& from, const TrDiffImage& to);
+    // Add new IQRF plugin if its records differ from the old one
+    void addIqrf(IqrfFmtParser& from, IqrfFmtParser& to);
+
+    // Load delta, throws exception if the file is invalid
+    void load(std::string name);
+    void save(std::string name) const;
+
+    typedef std::vector<TrDeltaSection>::const_iterator const_iterator;
+    const_iterator begin() const { return sections.begin(); }
+    const_iterator end() const { return sections.end(); }
+    bool hasIqrf() const { return iqrf; }
+    const IqrfPrgHeader& getPrgHeader() const { return prgHeader; }
+    const std::vector<std::basic_string<unsigned char>>& getRecords() const { return records; }
+};
+
+#endif // __TRDELTA_H__
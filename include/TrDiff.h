@@ -0,0 +1,68 @@
+/*
+ * Block by block comparison of TR memory images.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRDIFF_H__
+#define __TRDIFF_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <TrTypes.h>
+#include <HexFmtParser.h>
+#include <TrSnapshot.h>
+
+// Length of compared blocks, blocks are aligned to it
+static const size_t TR_DIFF_BLOCK_LEN = 32;
+
+/*
+ * Image of one TR memory at HEX file addresses, flash is addressed in
+ * bytes. Bytes which were not set are erased, see getTrFillPattern. Blocks
+ * with any byte set are marked dirty, blocks clean in both images are not
+ * compared.
+ */
+class TrDiffImage {
+private:
+    TrMemory memory;
+    // Data from address 0, always whole blocks
+    std::basic_string<unsigned char> data;
+    std::vector<uint64_t> dirty;
+    // Erased block
+    std::basic_string<unsigned char> erased;
+public:
+    TrDiffImage(TrMemory m);
+
+    // Set bytes, e.g. block downloaded from TR
+    void set(unsigned int addr, const unsigned char* bytes, size_t len);
+    void set(unsigned int addr, const std::basic_string<unsigned char>& bytes) { set(addr, bytes.data(), bytes.length()); }
+    // Set all blocks of parsed HEX file
+    void addHex(HexFmtParser& parser);
+    // Set all blocks of snapshot regions of the memory
+    void addSnapshot(const TrSnapshot& snapshot);
+
+    TrMemory getMemory() const { return memory; }
+    size_t getBlockCount() const { return (data.length() + TR_DIFF_BLOCK_LEN - 1) / TR_DIFF_BLOCK_LEN; }
+    bool isDirty(size_t block) const { return (block / 64 < dirty.size()) && ((dirty[block / 64] >> (block % 64)) & 1); }
+    // Dirty bits of blocks 64 * word to 64 * word + 63
+    uint64_t getDirtyWord(size_t word) const { return (word < dirty.size()) ? dirty[word] : 0; }
+    // Block of the image, blocks beyond the end are erased
+    const unsigned char* getBlock(size_t block) const;
+};
+
+// Block which differs, bit i of the mask is set if byte addr + i differs
+struct TrDiffBlock {
+    unsigned int addr;
+    uint32_t mask;
+    TrDiffBlock(unsigned int a, uint32_t m) : addr(a), mask(m) {}
+};
+
+// Byte mask of differences of two blocks of TR_DIFF_BLOCK_LEN bytes
+uint32_t diffTrBlock(const unsigned char* a, const unsigned char* b);
+
+// Differing blocks of two images of the same memory in order of addresses
+void diffTrImages(const TrDiffImage& a, const TrDiffImage& b, std::vector<TrDiffBlock>& diffs);
+
+#endif // __TRDIFF_H__
@@ -0,0 +1,71 @@
+/*
+ * Error codes of validation without exceptions.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRERROR_H__
+#define __TRERROR_H__
+
+#include <string>
+
+#include <TrTypes.h>
+#include <TrMemoryMap.h>
+
+enum class TrErrorCode {
+    OK,
+    // Block checks against memory map, memory and direction are set
+    OUT_OF_RANGE,
+    MISALIGNED,             // arg0 - modulo
+    END_OUT_OF_RANGE,
+    INVALID_LENGTH,         // arg0 - minimal length, arg1 - maximal length
+    // Data checks
+    INVALID_CFG_LENGTH,
+    INVALID_CFG_CHKSUM,
+    INVALID_SPECIAL_LENGTH,
+    INVALID_RFBAND,
+    INVALID_CHANNEL,        // arg0 - 0, 1 channel A, B of subordinate network, 2, 3 of main network
+    // IQRF plugin against module
+    UNSUPPORTED_TR,
+    UNSUPPORTED_OS
+};
+
+// Source location of the error for TrError constructors
+#define TR_ERROR_LOCATION __FILE__, __LINE__
+
+/*
+ * Result of validation. Only the code, the source location and the
+ * arguments are stored, the message is formatted when it is requested.
+ * File of the location must be a string literal.
+ */
+class TrError {
+private:
+    TrErrorCode code;
+    const char* file;
+    int line;
+    TrMemory memory;
+    TrDirection direction;
+    unsigned int arg0;
+    unsigned int arg1;
+public:
+    TrError() : code(TrErrorCode::OK), file(""), line(0), memory(TrMemory::ERROR), direction(TrDirection::UPLOAD), arg0(0), arg1(0) {}
+    TrError(TrErrorCode c, const char* f, int l, unsigned int a0 = 0, unsigned int a1 = 0)
+        : code(c), file(f), line(l), memory(TrMemory::ERROR), direction(TrDirection::UPLOAD), arg0(a0), arg1(a1) {}
+    TrError(TrErrorCode c, const char* f, int l, TrMemory m, TrDirection d, unsigned int a0 = 0, unsigned int a1 = 0)
+        : code(c), file(f), line(l), memory(m), direction(d), arg0(a0), arg1(a1) {}
+
+    bool isOk() const { return code == TrErrorCode::OK; }
+    TrErrorCode getCode() const { return code; }
+    const char* getFile() const { return file; }
+    int getLine() const { return line; }
+    TrMemory getMemory() const { return memory; }
+
+    // Message without source location
+    std::string getMessage() const;
+    // Throw TrException with the message of the error
+    void raise() const;
+};
+
+std::string getTrMemoryName(TrMemory memory);
+
+#endif // __TRERROR_H__
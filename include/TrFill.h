@@ -0,0 +1,25 @@
+/*
+ * Detection of erased blocks of TR memory.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRFILL_H__
+#define __TRFILL_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <TrTypes.h>
+
+/*
+ * Content of erased memory as 16b little endian word. Erased flash words
+ * are 0x3fff, erased eeprom bytes are 0xff.
+ */
+uint16_t getTrFillPattern(TrMemory memory);
+
+// Block consists only of the repeated fill pattern, block must start at
+// even byte of the memory
+bool isTrFillBlock(const unsigned char* data, size_t len, uint16_t fill);
+
+#endif // __TRFILL_H__
@@ -0,0 +1,52 @@
+/*
+ * Gang programming of identical TRs in lock-step.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRGANG_H__
+#define __TRGANG_H__
+
+#include <string>
+#include <vector>
+
+#include <TrIfc.h>
+#include <TrJob.h>
+#include <TrCommandStream.h>
+
+class TrGangBarrier;
+
+/*
+ * Programs one job into many TRs of the same type. The job is parsed,
+ * checked and compiled into a command stream once, every TR is served by
+ * its own thread and all TRs execute the same command of the stream before
+ * the next one is started. A TR which fails leaves the gang, the others
+ * continue without it.
+ */
+class TrGang {
+private:
+    struct Unit {
+        TrIfc* ifc;
+        std::string error;
+        Unit(TrIfc* i) : ifc(i) {}
+    };
+    std::vector<Unit> units;
+
+    void fail(Unit& unit, const std::string& error);
+    void run(Unit& unit, const TrCommandStream& stream, TrGangBarrier& barrier);
+public:
+    // Add TR, returns index of the device
+    size_t addDevice(TrIfc* ifc);
+
+    // Compile job for the type of the first TR which reports its module
+    // info and program it, returns false if any device failed
+    bool uploadJob(TrJob& job);
+    // Program compiled stream, returns false if any device failed
+    bool executeStream(const TrCommandStream& stream);
+
+    size_t getDeviceCount() const { return units.size(); }
+    bool failed(size_t device) const { return !units.at(device).error.empty(); }
+    std::string getError(size_t device) const { return units.at(device).error; }
+};
+
+#endif // __TRGANG_H__
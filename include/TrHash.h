@@ -0,0 +1,25 @@
+/*
+ * Hashing of TR memory images.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRHASH_H__
+#define __TRHASH_H__
+
+#include <string>
+#include <cstdint>
+
+// Streaming 64-bit FNV-1a hash
+class TrHash {
+private:
+    uint64_t state;
+public:
+    TrHash();
+    void update(const unsigned char* data, size_t len);
+    void update(const std::basic_string<unsigned char>& data) { update(data.data(), data.size()); }
+    void update(unsigned int value);
+    uint64_t digest() const { return state; }
+};
+
+#endif // __TRHASH_H__
@@ -8,9 +8,28 @@
 #define __TRIFC_H__
 
 #include <string>
+#include <memory>
+#include <vector>
 
 #include <IChannel.h>
 #include <TrTypes.h>
+#include <IqrfFmtParser.h>
+#include <HexFmtParser.h>
+#include <TrStats.h>
+#include <TrListener.h>
+#include <TrMemoryMap.h>
+#include <TrJob.h>
+#include <TrCommandStream.h>
+#include <TrVerify.h>
+#include <TrSnapshot.h>
+#include <TrBlockCache.h>
+#include <TrWriteBack.h>
+#include <TrMessage.h>
+#include <TrError.h>
+#include <TrImage.h>
+#include <TrLedger.h>
+#include <TrSnapshotStore.h>
+#include <TrDelta.h>
 
 class TrIfc {
 private:
@@ -19,8 +38,112 @@ private:
     
     // We are in proggramming mode
     bool prgMode;
+    
+    // Transfer statistics, null when disabled
+    std::unique_ptr<TrStats> stats;
+    
+    // Cache of downloaded blocks, null when disabled
+    std::unique_ptr<TrBlockCache> cache;
+    
+    // Buffered eeprom writes, null when disabled
+    std::unique_ptr<TrWriteBack> writeBack;
+    bool flushing;
+    
+    // Cached module info of the TR, description of its type if it is not known
+    TrModuleInfo moduleInfo;
+    bool moduleInfoValid;
+    std::string unknownType;
+    
+    // Memory map of the TR
+    const TrMemoryMap* memoryMap;
+    
+    // Listener of progress and events, may be null
+    TrListener* listener;
+    
+    // Checkpoint journal of resumable uploads
+    std::string checkpointName;
+    
+    // Read back verification of uploaded files
+    TrVerifyMode verifyMode;
+    unsigned int verifyPercent;
+    std::vector<TrVerifyBlock> verifyPending;
+    std::vector<TrMismatch> mismatches;
+    
+    // Ledger of programmed devices, may be null
+    TrLedger* ledger;
+    unsigned int ledgerSamples;
+    
+    // Downloaded block reused by consecutive read backs
+    struct ReadBackBlock {
+        TrMemory memory;
+        unsigned int base;
+        std::basic_string<unsigned char> data;
+        ReadBackBlock() : memory(TrMemory::ERROR), base(0) {}
+    };
+    
+    // Message passed to the channel, its buffer is reused by all transfers
+    std::basic_string<unsigned char> channelMsg;
+    
+    // Read module info once and select memory map of the TR, TR of unknown
+    // type keeps the current memory map
+    const TrModuleInfo& readModuleInfo();
+    
+    // Transfers through the channel
+    void channelUpload(unsigned char target, const TrMessage& msg);
+    void channelDownload(unsigned char target, const TrMessage& msg, std::basic_string<unsigned char>& data);
+    void sendUpload(unsigned char target, const TrMessage& msg);
+    void sendDownload(unsigned char target, const TrMessage& msg, std::basic_string<unsigned char>& data);
+    
+    // Check block against memory map, throws exception if the check fails
+    void checkBlock(TrMemory memory, TrDirection direction, unsigned int addr, size_t len);
+    
+    // Upload block already checked against memory map
+    void sendBlock(unsigned char target, unsigned int addr, const std::basic_string<unsigned char>& data);
+    void sendBlock(unsigned char target, unsigned int addr, const unsigned char* data, size_t len);
+    
+    // Upload checked files
+    void uploadHex(TrMemory memory, HexFmtParser& parser, size_t first);
+    void uploadIqrf(IqrfFmtParser& parser);
+    // Read back data written at HEX file address
+    void readBack(TrMemory memory, unsigned int addr, size_t len, std::basic_string<unsigned char>& data);
+    void readBack(TrMemory memory, unsigned int addr, size_t len, std::basic_string<unsigned char>& data, ReadBackBlock& block);
+    void readBack(const TrVerifyBlock& written, std::basic_string<unsigned char>& data, ReadBackBlock& block);
+    
+    // Verify written blocks according to verification mode
+    void verifyWritten(std::vector<TrVerifyBlock>& blocks);
+    // Read back blocks and compare them, throws exception if any block differs
+    void verifyBlocks(std::vector<TrVerifyBlock>& blocks);
+    
+    // Part of job is current if the ledger knows it and sampled blocks read
+    // back equal, parts are empty without ledger
+    bool isPartCurrent(TrSerial serial, const std::vector<TrLedgerEntry>& parts, size_t part, 
+                       const std::vector<TrVerifyBlock>& samples);
+    // Read back pre-image of delta section, changed blocks which still hold
+    // their old content are pending. False if any changed block holds neither
+    // its old nor its new content or if any other block of the pre-image differs.
+    bool readDeltaSection(const TrDeltaSection& section, std::vector<TrDeltaBlock>& pending);
+    
+    // Record written part, in deferred verification mode after the verification.
+    // Without verification the samples are read back before recording.
+    void recordPart(TrSerial serial, const std::vector<TrLedgerEntry>& parts, size_t part, 
+                    const std::vector<TrVerifyBlock>& samples, std::vector<TrLedgerEntry>& pending);
+    
+    // Upload buffered eeprom writes
+    void flushInternalEeprom(const TrWriteBack& pending);
+    void flushExternalEeprom(const TrWriteBack& pending);
+    
+    // Download snapshot region by region, restore loaded snapshot, name is
+    // used in messages
+    void snapshot(TrSnapshotSink& writer);
+    void restore(const TrSnapshot& snapshot, const std::string& name);
+    
+    // Upload parts of live block which differ from snapshot block, returns
+    // number of differing parts outside of writable memory
+    size_t restoreBlock(TrMemory memory, unsigned int addr, const std::basic_string<unsigned char>& live, 
+                        const std::basic_string<unsigned char>& block);
 public:
-    TrIfc(IChannel* c) : ifc(c), prgMode(false) {}
+    TrIfc(IChannel* c) : ifc(c), prgMode(false), flushing(false), moduleInfoValid(false), memoryMap(&TrMemoryMapTraits<TrMcu::PIC16F1938, TrSerie::DCTR_5xD>::map), listener(nullptr),
+                        verifyMode(TrVerifyMode::NONE), verifyPercent(100), ledger(nullptr), ledgerSamples(0) {}
     
     // Enter programming mode
     void enterProgrammingMode();
@@ -28,6 +151,30 @@ public:
     // Terminate proggramming mode
     void terminateProgrammingMode();
     
+    // Listener of progress, phase changes and parser notes
+    void setListener(TrListener* l) { listener = l; }
+    
+    // Transfer statistics per programming target, disabled by default
+    void enableStats(bool enable);
+    TrStats getStats() const;
+    void resetStats();
+    
+    // Cache of downloaded blocks, disabled by default. Uploads are written
+    // through, the cache is cleared when programming mode is terminated.
+    // Read back verification and resume always read the TR.
+    void enableCache(bool enable);
+    void invalidateCache();
+    
+    // Write back buffer of uploadInternalEeprom and uploadExternalEeprom,
+    // disabled by default. Buffered writes may be of any length, external
+    // eeprom writes need not be aligned. Overlapping and adjacent writes are
+    // merged and uploaded by flush(), before downloads of eeprom, before other
+    // uploads into eeprom, before special uploads and before programming mode
+    // is terminated. Writes stay buffered until flush() succeeds, so flush()
+    // may be called again after a failure.
+    void enableWriteBack(bool enable);
+    void flush();
+    
     // Upload to device
     // Upload Tr configuration - HWP profile
     void uploadCfg(const std::basic_string<unsigned char>& data);
@@ -53,6 +200,88 @@ public:
     void uploadIqrf(std::string name);
     void uploadCfg(std::string name);
     
+    // Set checkpoint journal for resumable uploads of HEX files, empty name disables it
+    void setCheckpoint(std::string name) { checkpointName = name; }
+    // Resume upload of HEX file interrupted after last checkpoint
+    void resumeHex(TrMemory memory, std::string name);
+    // IQRF plugin can not be read back and is accepted only as a whole, its
+    // upload is not journalled and always restarts from the first record
+    void resumeIqrf(std::string name);
+    
+    // Read back verification of uploaded HEX and TRCONF files, disabled by
+    // default. Percentage applies to the sampled mode.
+    void setVerify(TrVerifyMode mode, unsigned int percent = 100);
+    TrVerifyMode getVerifyMode() const { return verifyMode; }
+    unsigned int getVerifyPercent() const { return verifyPercent; }
+    // Verify blocks collected in the deferred mode, must be in programming mode
+    void verify();
+    // Mismatching blocks found since the verification was set
+    const std::vector<TrMismatch>& getMismatches() const { return mismatches; }
+    
+    // Ledger of content programmed into devices, nullptr disables it. Parts
+    // of jobs which the ledger knows to be current in the TR are skipped by
+    // uploadJob, given number of blocks of each skipped HEX file and TRCONF
+    // are read back first. Written parts are recorded only when verified,
+    // without verification mode at least one block of each written HEX file
+    // and TRCONF is read back. Ledger is saved by uploadJob, also when it fails.
+    void setLedger(TrLedger* l, unsigned int samples = 0) { ledger = l; ledgerSamples = samples; }
+    
+    // Module info of the TR, read once and cached, throws exception for unknown
+    // type of TR. It is read only when needed - by IQRF checks, jobs, ledger,
+    // command streams and snapshots. Reading it in programming mode costs one
+    // round of mode switches, so those read it before entering the mode.
+    const TrModuleInfo& getModuleInfo();
+    // Forget cached module info, e.g. after TR was replaced or its OS upgraded
+    void invalidateModuleInfo();
+    
+    // Select memory map of TR type, default is PIC16F1938 based DCTR-5xD,
+    // otherwise it is selected when module info is read
+    void setMemoryMap(TrMcu mcu, TrSerie serie);
+    const TrMemoryMap& getMemoryMap() const { return *memoryMap; }
+    // Check whole parsed HEX file against memory map
+    void checkHex(TrMemory memory, HexFmtParser& parser);
+    
+    // Validation without exceptions, the check functions throw the returned
+    // error. Flash addresses are in 16b words.
+    TrError validateBlock(TrMemory memory, TrDirection direction, unsigned int addr, size_t len) const;
+    static TrError validateCfg(const std::basic_string<unsigned char>& data);
+    static TrError validateSpecial(const std::basic_string<unsigned char>& data);
+    
+    // Check compatibility of parsed IQRF file with TR
+    void checkIqrf(IqrfFmtParser& parser);
+    // Check records of parsed IQRF file
+    void checkIqrfData(IqrfFmtParser& parser);
+    
+    // Check whole job - images against memory map of the TR, TRCONF data and
+    // IQRF compatibility. Outside of programming mode it switches no mode.
+    void checkJob(TrJob& job);
+    // Check job and program it in one programming mode session. TRCONF channels
+    // are checked after entering programming mode, still before the first write.
+    void uploadJob(TrJob& job);
+    
+    // Check blocks of image against memory map and its IQRF plugin against TR
+    void checkImage(const TrImageOverlay& image);
+    // Check image and program it in one programming mode session. Image is
+    // only read, so one image can be programmed into many TRs at once.
+    void uploadImage(const TrImageOverlay& image);
+    void uploadImage(std::shared_ptr<const TrImage> image);
+    // Check blocks of delta against memory map and its IQRF plugin against TR
+    void checkDelta(const TrDelta& delta);
+    // Apply delta if the TR matches old image of the delta, confirmed by hashes
+    // of read back blocks, throws exception before the first write otherwise.
+    // Changed blocks may already hold the new content, e.g. after interrupted
+    // application of the delta, only the blocks still holding old content are
+    // written.
+    void uploadDelta(const TrDelta& delta);
+    void uploadDelta(std::string name);
+    // Execute command stream compiled for the type of the TR. Uploads are sent
+    // as they are stored, without checks and message assembly.
+    void executeStream(const TrCommandStream& stream);
+    // Check that the stream was compiled for the type of the TR
+    void checkStream(const TrCommandStream& stream);
+    // Execute one command of checked stream, name is used in error messages
+    void executeCommand(const TrCommand& command, const std::string& name);
+    
     // Download from device
     // Download Tr configuration - HWP profile
     void downloadCfg(std::basic_string<unsigned char>& data);
@@ -69,7 +298,20 @@ public:
     
     // Download files
     void downloadCfg(std::string name);
-    void downloadHex(TrMemory memory, unsigned int addr, size_t len, std::string name);
+    // Blocks of erased memory are not written into the HEX file if elide is
+    // true, HexFmtParser::fill with getTrFillPattern adds them back
+    void downloadHex(TrMemory memory, unsigned int addr, size_t len, std::string name, bool elide = false);
+    
+    // Download configuration, RFPMG, RFBAND and all downloadable memory into one
+    // snapshot file together with module info
+    void snapshot(std::string name);
+    // Restore snapshot taken from TR of the same type and OS. Only blocks which
+    // differ from the TR are uploaded.
+    void restore(std::string name);
+    // Snapshot into the store and restore from it, blocks already in the store
+    // are not stored again
+    void snapshot(TrSnapshotStore& store, std::string name);
+    void restore(TrSnapshotStore& store, std::string name);
 };
 
 #endif // __TRIFC_H__
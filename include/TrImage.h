@@ -0,0 +1,95 @@
+/*
+ * Immutable firmware image shared by programming sessions.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRIMAGE_H__
+#define __TRIMAGE_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include <TrTypes.h>
+#include <HexFmtParser.h>
+#include <IqrfFmtParser.h>
+
+// Block of image at HEX file address, flash is addressed in bytes
+struct TrImageBlock {
+    TrMemory memory;
+    unsigned int addr;
+    std::basic_string<unsigned char> data;
+    TrImageBlock(TrMemory m, unsigned int a, const std::basic_string<unsigned char>& d) : memory(m), addr(a), data(d) {}
+};
+
+/*
+ * Blocks of parsed HEX files and records of parsed IQRF file detached from
+ * the parsers. Image can not be changed once it is built and it is shared
+ * by std::shared_ptr, so any number of threads and TrIfc instances can
+ * program it at the same time.
+ */
+class TrImage {
+private:
+    std::vector<TrImageBlock> blocks;
+    std::vector<std::basic_string<unsigned char>> records;
+    IqrfPrgHeader prgHeader;
+    bool iqrf;
+    // Blocks by memory and address
+    std::map<std::pair<TrMemory, unsigned int>, size_t> index;
+    size_t blockLenMax;
+
+    friend class TrImageBuilder;
+    TrImage() : iqrf(false), blockLenMax(0) {}
+public:
+    size_t getBlockCount() const { return blocks.size(); }
+    const TrImageBlock& getBlock(size_t i) const { return blocks[i]; }
+
+    // IQRF plugin of the image
+    bool hasIqrf() const { return iqrf; }
+    const IqrfPrgHeader& getPrgHeader() const { return prgHeader; }
+    const std::vector<std::basic_string<unsigned char>>& getRecords() const { return records; }
+
+    // Indexes of blocks overlapping bytes addr to addr + len - 1
+    void findBlocks(TrMemory memory, unsigned int addr, size_t len, std::vector<size_t>& found) const;
+};
+
+// Collects parsed files into a new image
+class TrImageBuilder {
+private:
+    std::shared_ptr<TrImage> image;
+public:
+    TrImageBuilder() : image(new TrImage()) {}
+    void addHex(TrMemory memory, HexFmtParser& parser);
+    void setIqrf(IqrfFmtParser& parser);
+    // Finish the image, next image is started by the builder
+    std::shared_ptr<const TrImage> build();
+};
+
+/*
+ * Image of one device - the shared base image with own copies of blocks
+ * changed by patches. Unchanged blocks are not copied.
+ */
+class TrImageOverlay {
+private:
+    std::shared_ptr<const TrImage> base;
+    std::map<size_t, TrImageBlock> patched;
+public:
+    explicit TrImageOverlay(std::shared_ptr<const TrImage> image);
+
+    // Overwrite bytes of the image, throws exception if any byte is not in
+    // a block of the image
+    void patch(TrMemory memory, unsigned int addr, const std::basic_string<unsigned char>& data);
+    // Drop all patches
+    void reset() { patched.clear(); }
+
+    const TrImage& getBase() const { return *base; }
+    size_t getBlockCount() const { return base->getBlockCount(); }
+    // Patched copy of the block or the block of base image
+    const TrImageBlock& getBlock(size_t i) const;
+    size_t getPatchedCount() const { return patched.size(); }
+};
+
+#endif // __TRIMAGE_H__
@@ -0,0 +1,55 @@
+/*
+ * Programming job - files programmed into TR in one session.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRJOB_H__
+#define __TRJOB_H__
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <TrTypes.h>
+#include <TrListener.h>
+#include <HexFmtParser.h>
+#include <IqrfFmtParser.h>
+#include <TrconfFmtParser.h>
+
+// HEX file of programming job
+struct TrJobHex {
+    TrMemory memory;
+    HexFmtParser parser;
+    TrJobHex(TrMemory m, std::string name) : memory(m), parser(m, name) {}
+};
+
+/*
+ * Files are programmed in order TRCONF, HEX files in order of addition, IQRF.
+ * All files are parsed at once before the programming starts.
+ */
+class TrJob {
+private:
+    std::unique_ptr<TrconfFmtParser> trconf;
+    std::vector<TrJobHex> hex;
+    std::unique_ptr<IqrfFmtParser> iqrf;
+    bool parsed;
+public:
+    TrJob() : parsed(false) {}
+    void setTrconf(std::string name);
+    void addHex(TrMemory memory, std::string name);
+    void setIqrf(std::string name);
+    
+    // Parse all files of the job
+    void parse(TrListener* listener = nullptr);
+    bool isParsed() const { return parsed; }
+    
+    // Parsed files, nullptr if the job has no such file
+    TrconfFmtParser* getTrconf() { return trconf.get(); }
+    IqrfFmtParser* getIqrf() { return iqrf.get(); }
+    typedef std::vector<TrJobHex>::iterator hex_iterator;
+    hex_iterator hexBegin() { return hex.begin(); }
+    hex_iterator hexEnd() { return hex.end(); }
+};
+
+#endif // __TRJOB_H__
@@ -0,0 +1,71 @@
+/*
+ * Ledger of content programmed into TR devices.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRLEDGER_H__
+#define __TRLEDGER_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+#include <TrTypes.h>
+
+// Programmed part of the device
+enum class TrLedgerItem : unsigned char {
+    CFG,
+    RFPMG,
+    FLASH,
+    INTERNAL_EEPROM,
+    EXTERNAL_EEPROM,
+    IQRF
+};
+
+/*
+ * Content of one region of the device. HEX file regions span from the first
+ * to the end of the last block at HEX file addresses, other items have
+ * whole region 0 - 0.
+ */
+struct TrLedgerEntry {
+    TrLedgerItem item;
+    unsigned int addr;
+    unsigned int end;
+    uint64_t hash;
+    TrLedgerEntry(TrLedgerItem i, unsigned int a, unsigned int e, uint64_t h) : item(i), addr(a), end(e), hash(h) {}
+};
+
+/*
+ * Local file with the content last written into each device, devices are
+ * identified by their module ID. The ledger knows only writes recorded by
+ * its users, the device can be checked by read back before the ledger is
+ * trusted. One ledger can be shared by TrIfc instances of many threads.
+ */
+class TrLedger {
+private:
+    std::string file_name;
+    std::map<TrSerial, std::vector<TrLedgerEntry>> devices;
+    mutable std::mutex mutex;
+public:
+    TrLedger(std::string name) : file_name(name) {}
+    // Load ledger, returns false and starts empty ledger if there is no valid one
+    bool load();
+    // Write ledger, the file is replaced at once
+    void save();
+
+    // Device has the region with the same content
+    bool isCurrent(TrSerial serial, const TrLedgerEntry& entry) const;
+    // Record region written into the device, overlapping regions of the same
+    // item are forgotten
+    void record(TrSerial serial, const TrLedgerEntry& entry);
+    // Forget regions overlapping region which is going to be written
+    void invalidate(TrSerial serial, const TrLedgerEntry& entry);
+    // Forget device, e.g. after it was programmed by other means
+    void forget(TrSerial serial);
+    size_t getDeviceCount() const;
+};
+
+#endif // __TRLEDGER_H__
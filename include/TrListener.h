@@ -0,0 +1,87 @@
+/*
+ * Progress and event reporting of TR interface and file format parsers.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRLISTENER_H__
+#define __TRLISTENER_H__
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+enum class TrPhase {
+    ENTER_PRG_MODE,
+    TERMINATE_PRG_MODE,
+    UPLOAD_CFG,
+    UPLOAD_HEX,
+    UPLOAD_IQRF,
+    DOWNLOAD_HEX,
+    EXECUTE_STREAM,
+    VERIFY,
+    SNAPSHOT,
+    RESTORE
+};
+
+enum class TrSeverity {
+    NOTE,
+    WARNING
+};
+
+// Note or warning of file format parser
+struct TrNote {
+    TrSeverity severity;
+    std::string file;
+    size_t line;
+    std::string text;
+    TrNote(TrSeverity s, std::string f, size_t l, std::string t) : severity(s), file(f), line(l), text(t) {}
+};
+
+// Progress of block transfers
+struct TrProgress {
+    TrPhase phase;
+    size_t done;        // Number of transferred blocks
+    size_t total;       // Number of all blocks
+    size_t bytes;       // Number of transferred bytes
+    double eta;         // Estimated time to finish in seconds
+};
+
+/*
+ * Listener of events. Progress is delivered in batches - at most once per
+ * percent of transferred blocks, notes of a parser at once after parsing,
+ * also when parsing fails.
+ */
+class TrListener {
+public:
+    virtual ~TrListener() {}
+    virtual void onPhase(TrPhase /* phase */) {}
+    virtual void onProgress(const TrProgress& /* progress */) {}
+    virtual void onNotes(const std::vector<TrNote>& /* notes */) {}
+};
+
+// Deliver notes to the listener, without listener they are written to std::cerr
+void reportNotes(TrListener* listener, const std::vector<TrNote>& notes);
+
+// Collects progress of block transfers and reports it to the listener
+class TrProgressTracker {
+private:
+    TrListener* listener;
+    TrProgress progress;
+    size_t first;
+    size_t next;
+    std::chrono::steady_clock::time_point start;
+
+    void report();
+public:
+    TrProgressTracker(TrListener* listener, TrPhase phase, size_t total, size_t done = 0);
+    void advance(size_t len) {
+        progress.done++;
+        progress.bytes += len;
+        if (listener && (progress.done >= next)) {
+            report();
+        }
+    }
+};
+
+#endif // __TRLISTENER_H__
@@ -0,0 +1,97 @@
+/*
+ * Memory maps of TR modules.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRMEMORYMAP_H__
+#define __TRMEMORYMAP_H__
+
+#include <cstddef>
+
+#include <TrTypes.h>
+
+enum class TrDirection {
+    UPLOAD,
+    DOWNLOAD
+};
+
+// Result of block check against memory map
+enum class TrMemoryCheck {
+    OK,
+    OUT_OF_RANGE,
+    MISALIGNED,
+    END_OUT_OF_RANGE,
+    INVALID_LENGTH
+};
+
+/*
+ * Addressable region of TR memory for one direction. Flash addresses are
+ * in 16b words, EEPROM addresses in bytes. Length limits of downloads
+ * apply to the downloaded data.
+ */
+struct TrMemoryRegion {
+    TrMemory memory;
+    TrDirection direction;
+    unsigned int low;       // Lowest block address
+    unsigned int high;      // Highest address of block start
+    unsigned int modulo;    // Alignment of block address
+    size_t lenMin;          // Block length limits, 0 - not checked
+    size_t lenMax;
+    unsigned int end;       // Block must end below this address, 0 - not checked
+};
+
+static const size_t TR_MEMORY_REGION_MAX = 8;
+
+struct TrMemoryMap {
+    TrMcu mcu;
+    TrSerie serie;
+    size_t count;
+    TrMemoryRegion regions[TR_MEMORY_REGION_MAX];
+
+    // Region containing the block address or nullptr
+    const TrMemoryRegion* find(TrMemory memory, TrDirection direction, unsigned int addr) const;
+    // Check block, length 0 checks only the address
+    TrMemoryCheck check(TrMemory memory, TrDirection direction, unsigned int addr, size_t len) const;
+    // Region and address of the downloaded block containing the address or
+    // nullptr. Internal eeprom above the downloadable range is downloaded from
+    // the end of the range.
+    const TrMemoryRegion* findDownload(TrMemory memory, unsigned int addr, unsigned int& base) const;
+};
+
+// Memory map of TRs with PIC16F1938
+constexpr TrMemoryMap makePic16f1938MemoryMap(TrSerie serie) {
+    return TrMemoryMap {
+        TrMcu::PIC16F1938, serie, 8, {
+            // Flash regions end at the last word of application and extended
+            // flash, aligned blocks starting at or below high end inside them
+            {TrMemory::FLASH,           TrDirection::UPLOAD,   0x3a00, 0x3fff, 16,  32, 32, 0},
+            {TrMemory::FLASH,           TrDirection::UPLOAD,   0x2c00, 0x37bf, 16,  32, 32, 0},
+            {TrMemory::FLASH,           TrDirection::DOWNLOAD, 0x3a00, 0x3fff, 32,  0,  0,  0},
+            {TrMemory::FLASH,           TrDirection::DOWNLOAD, 0x2c00, 0x37bf, 32,  0,  0,  0},
+            {TrMemory::INTERNAL_EEPROM, TrDirection::UPLOAD,   0x0000, 0x00bf, 1,   1,  32, 0x00c0},
+            {TrMemory::INTERNAL_EEPROM, TrDirection::DOWNLOAD, 0x0000, 0x00a0, 1,   32, 32, 0},
+            {TrMemory::EXTERNAL_EEPROM, TrDirection::UPLOAD,   0x0000, 0x3fe0, 32,  32, 32, 0},
+            {TrMemory::EXTERNAL_EEPROM, TrDirection::DOWNLOAD, 0x0000, 0x7fe0, 32,  32, 32, 0}
+        }
+    };
+}
+
+// Compile time memory map of TR type, unsupported types have no map
+template <TrMcu mcu, TrSerie serie>
+struct TrMemoryMapTraits;
+
+template <>
+struct TrMemoryMapTraits<TrMcu::PIC16F1938, TrSerie::DCTR_5xD> {
+    static constexpr TrMemoryMap map = makePic16f1938MemoryMap(TrSerie::DCTR_5xD);
+};
+
+template <>
+struct TrMemoryMapTraits<TrMcu::PIC16F1938, TrSerie::DCTR_7xD> {
+    static constexpr TrMemoryMap map = makePic16f1938MemoryMap(TrSerie::DCTR_7xD);
+};
+
+// Memory map of TR type, nullptr for unsupported types
+const TrMemoryMap* getTrMemoryMap(TrMcu mcu, TrSerie serie);
+
+#endif // __TRMEMORYMAP_H__
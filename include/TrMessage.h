@@ -0,0 +1,63 @@
+/*
+ * Fixed capacity message of programming protocol.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRMESSAGE_H__
+#define __TRMESSAGE_H__
+
+#include <string>
+#include <cstddef>
+#include <algorithm>
+
+#include <TrException.h>
+
+// Longest message of the protocol, 16b address and 32B of data
+static const size_t TR_MESSAGE_LEN_MAX = 34;
+
+/*
+ * Message built on the stack without heap allocation. Appending beyond the
+ * protocol maximum throws exception.
+ */
+class TrMessage {
+private:
+    unsigned char buffer[TR_MESSAGE_LEN_MAX];
+    size_t len;
+
+    void reserve(size_t count) {
+        if (len + count > TR_MESSAGE_LEN_MAX) {
+            TR_THROW_EXCEPTION(TrException, "Message is longer than " + std::to_string(TR_MESSAGE_LEN_MAX) + "B!");
+        }
+    }
+public:
+    TrMessage() : len(0) {}
+    explicit TrMessage(const std::basic_string<unsigned char>& data) : len(0) {
+        append(data.data(), data.length());
+    }
+
+    void append(unsigned char value) {
+        reserve(1);
+        buffer[len++] = value;
+    }
+
+    void append(const unsigned char* data, size_t count) {
+        reserve(count);
+        std::copy(data, data + count, buffer + len);
+        len += count;
+    }
+
+    // Little endian 16b address
+    void appendAddress(unsigned int addr) {
+        reserve(2);
+        buffer[len++] = addr & 0xff;
+        buffer[len++] = (addr >> 8) & 0xff;
+    }
+
+    void clear() { len = 0; }
+    const unsigned char* data() const { return buffer; }
+    size_t length() const { return len; }
+    unsigned char operator[](size_t i) const { return buffer[i]; }
+};
+
+#endif // __TRMESSAGE_H__
@@ -0,0 +1,99 @@
+/*
+ * Dry-run planning of programming jobs.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRPLANNER_H__
+#define __TRPLANNER_H__
+
+#include <vector>
+#include <array>
+
+#include <TrTypes.h>
+#include <TrJob.h>
+#include <TrStats.h>
+#include <TrMemoryMap.h>
+#include <TrVerify.h>
+#include <TrIfc.h>
+
+enum class TrOperation {
+    MODULE_INFO,
+    ENTER_PRG_MODE,
+    TERMINATE_PRG_MODE,
+    UPLOAD,
+    DOWNLOAD
+};
+
+// One device transaction
+struct TrTransaction {
+    TrOperation operation;
+    TrTarget target;
+    unsigned int addr;  // Address in TR memory, flash is addressed in 16b words
+    size_t len;         // Length of transferred message
+    TrTransaction(TrOperation o, TrTarget t = TrTarget::CFG, unsigned int a = 0, size_t l = 0) 
+        : operation(o), target(t), addr(a), len(l) {}
+};
+
+enum class TrChannelType {
+    CDC,
+    SPI
+};
+
+/*
+ * Latency model of channel, times are in microseconds. Default values are
+ * rough, calibrate them from statistics of real sessions.
+ */
+struct TrLatencyModel {
+    double moduleInfo;
+    double enterMode;
+    double terminateMode;
+    double perByte;
+    std::array<double, TR_TARGET_COUNT> perTransaction;
+
+    static TrLatencyModel getDefault(TrChannelType type);
+    // Take mean latencies measured by TrIfc with statistics enabled
+    void calibrate(const TrStats& stats);
+    double estimate(const TrTransaction& transaction) const;
+};
+
+class TrPlan {
+private:
+    std::vector<TrTransaction> transactions;
+public:
+    void add(const TrTransaction& transaction) { transactions.push_back(transaction); }
+    typedef std::vector<TrTransaction>::const_iterator const_iterator;
+    const_iterator begin() const { return transactions.begin(); }
+    const_iterator end() const { return transactions.end(); }
+    size_t size() const { return transactions.size(); }
+    // Estimated duration in seconds
+    double estimate(const TrLatencyModel& model) const;
+};
+
+/*
+ * Produces transactions of TrIfc::uploadJob in the same order without
+ * touching a device, read backs of the verification included. Blocks are
+ * checked against the memory map. The plan is exact for TrIfc which has not
+ * read module info yet and has no ledger. Parts skipped by a ledger and read
+ * backs confirming parts recorded into it are not planned.
+ */
+class TrPlanner {
+private:
+    const TrMemoryMap& memoryMap;
+    TrVerifyMode verifyMode;
+    unsigned int verifyPercent;
+
+    // Read backs of written blocks according to verification mode, blocks of
+    // the deferred mode are collected
+    void planVerify(const std::vector<TrVerifyBlock>& written, std::vector<TrVerifyBlock>& deferred, TrPlan& plan) const;
+    void planReadBack(std::vector<TrVerifyBlock> blocks, TrPlan& plan) const;
+public:
+    TrPlanner(const TrMemoryMap& map, TrVerifyMode mode = TrVerifyMode::NONE, unsigned int percent = 100) 
+        : memoryMap(map), verifyMode(mode), verifyPercent(percent) {}
+    // Memory map currently selected by TR interface and its verification
+    TrPlanner(const TrIfc& ifc) 
+        : memoryMap(ifc.getMemoryMap()), verifyMode(ifc.getVerifyMode()), verifyPercent(ifc.getVerifyPercent()) {}
+    TrPlan plan(TrJob& job);
+};
+
+#endif // __TRPLANNER_H__
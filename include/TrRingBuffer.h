@@ -0,0 +1,82 @@
+/*
+ * Bounded ring buffer between producer and consumer thread.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRRINGBUFFER_H__
+#define __TRRINGBUFFER_H__
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+
+/*
+ * Items are swapped in and out of preallocated slots, so the buffers of
+ * items are reused and memory stays constant. After close() the consumer
+ * gets remaining items, after abort() the remaining items are dropped.
+ */
+template <typename T>
+class TrRingBuffer {
+private:
+    std::vector<T> slots;
+    size_t head;
+    size_t count;
+    bool closed;
+    bool aborted;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+public:
+    TrRingBuffer(size_t capacity, const T& init) : slots(capacity, init), head(0), count(0), closed(false), aborted(false) {}
+
+    // Blocks while the buffer is full, returns false if it was closed
+    bool push(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this]{ return (count < slots.size()) || closed; });
+        if (closed) {
+            return false;
+        }
+        std::swap(slots[(head + count) % slots.size()], item);
+        count++;
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks while the buffer is empty, returns false if there is no more item
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this]{ return (count > 0) || closed; });
+        if ((count == 0) || aborted) {
+            return false;
+        }
+        std::swap(slots[head], item);
+        head = (head + 1) % slots.size();
+        count--;
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    void abort() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        aborted = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    bool isAborted() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return aborted;
+    }
+};
+
+#endif // __TRRINGBUFFER_H__
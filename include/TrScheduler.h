@@ -0,0 +1,97 @@
+/*
+ * Bus-aware scheduler for programming of multiple TRs.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRSCHEDULER_H__
+#define __TRSCHEDULER_H__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+
+#include <TrIfc.h>
+#include <TrTypes.h>
+#include <HexFmtParser.h>
+#include <IqrfFmtParser.h>
+#include <TrconfFmtParser.h>
+
+// Unit of work on one TR executed block by block
+class TrTask {
+public:
+    virtual ~TrTask() {}
+    // Execute next block transfer, returns false when the task is finished
+    virtual bool step(TrIfc& ifc) = 0;
+};
+
+// Upload of TRCONF file - RFBAND check, configuration and RFPMG
+class TrCfgUploadTask : public TrTask {
+private:
+    TrconfFmtParser parser;
+    int state;
+public:
+    TrCfgUploadTask(std::string name) : parser(name), state(0) {}
+    bool step(TrIfc& ifc);
+};
+
+// Upload of HEX file, one block per step
+class TrHexUploadTask : public TrTask {
+private:
+    TrMemory memory;
+    HexFmtParser parser;
+    HexFmtParser::iterator itr;
+    bool parsed;
+public:
+    TrHexUploadTask(TrMemory memory, std::string name) : memory(memory), parser(memory, name), parsed(false) {}
+    bool step(TrIfc& ifc);
+};
+
+// Upload of IQRF file, one special upload per step
+class TrIqrfUploadTask : public TrTask {
+private:
+    IqrfFmtParser parser;
+    IqrfFmtParser::iterator itr;
+    bool checked;
+public:
+    TrIqrfUploadTask(std::string name) : parser(name), checked(false) {}
+    bool step(TrIfc& ifc);
+};
+
+/*
+ * Runs tasks on several TRs. TRs attached to the same bus (e.g. TRs sharing
+ * one SPI controller) are served by a single thread which interleaves their
+ * tasks at block granularity. TRs on different buses are served in parallel.
+ */
+class TrScheduler {
+private:
+    struct Device {
+        std::string bus;
+        TrIfc* ifc;
+        std::deque<std::shared_ptr<TrTask>> tasks;
+        bool started;
+        bool finished;
+        std::string error;
+        Device(std::string b, TrIfc* i) : bus(b), ifc(i), started(false), finished(false) {}
+    };
+    std::vector<Device> devices;
+
+    // Record the first error of the device and leave programming mode
+    void fail(Device& device, const std::string& error);
+    bool step(Device& device);
+    void runBus(std::vector<Device*> bus);
+public:
+    // Add TR attached to the bus, returns index of the device
+    size_t addDevice(std::string bus, TrIfc* ifc);
+    // Append task for the device
+    void addTask(size_t device, std::shared_ptr<TrTask> task);
+    // Run all tasks, returns false if any device failed
+    bool run();
+
+    size_t getDeviceCount() const { return devices.size(); }
+    bool failed(size_t device) const { return !devices.at(device).error.empty(); }
+    std::string getError(size_t device) const { return devices.at(device).error; }
+};
+
+#endif // __TRSCHEDULER_H__
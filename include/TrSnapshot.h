@@ -0,0 +1,91 @@
+/*
+ * Snapshot of whole TR memory in a single binary container.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRSNAPSHOT_H__
+#define __TRSNAPSHOT_H__
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+#include <TrTypes.h>
+#include <TrHash.h>
+
+// Version of snapshot format
+static const unsigned char TR_SNAPSHOT_VERSION = 2;
+
+/*
+ * Region of TR memory downloaded block by block. Block i starts at device
+ * address addr + i * step, flash is addressed in 16b words. Configuration,
+ * RFPMG and RFBAND are regions with one block. Blocks of erased memory
+ * filled with the fill pattern are not stored in the file, loaded regions
+ * always contain all blocks.
+ */
+struct TrSnapshotRegion {
+    TrTarget target;
+    unsigned int addr;
+    unsigned int step;
+    size_t blockLen;
+    bool elide;         // Fill blocks are not stored
+    uint16_t fill;      // Fill pattern, see getTrFillPattern
+    uint64_t hash;      // Hash of all blocks
+    std::basic_string<unsigned char> data;
+    TrSnapshotRegion() : target(TrTarget::CFG), addr(0), step(0), blockLen(0), elide(false), fill(0), hash(0) {}
+    size_t getBlockCount() const { return blockLen ? data.length() / blockLen : 0; }
+};
+
+// Receiver of snapshot regions as the blocks are downloaded
+class TrSnapshotSink {
+public:
+    virtual ~TrSnapshotSink() {}
+    // Elided region does not store blocks of the fill pattern
+    virtual void beginRegion(TrTarget target, unsigned int addr, unsigned int step, bool elide = false, uint16_t fill = 0) = 0;
+    virtual void writeBlock(const std::basic_string<unsigned char>& data) = 0;
+    virtual void endRegion() = 0;
+};
+
+// Writes snapshot file region by region as the blocks are downloaded
+class TrSnapshotWriter : public TrSnapshotSink {
+private:
+    std::string file_name;
+    std::ofstream file;
+    uint32_t regions;
+    std::streampos regionPos;
+    // Header of written region, its data are not kept
+    TrSnapshotRegion region;
+    size_t regionLen;
+    uint32_t blocks;
+    std::basic_string<unsigned char> stored;   // Bitmap of stored blocks
+    TrHash hash;
+
+    void write(const unsigned char* data, size_t len);
+public:
+    TrSnapshotWriter(std::string name, const TrModuleInfo& info);
+    void beginRegion(TrTarget target, unsigned int addr, unsigned int step, bool elide = false, uint16_t fill = 0);
+    void writeBlock(const std::basic_string<unsigned char>& data);
+    void endRegion();
+    // Finish snapshot file, throws exception if it can not be written
+    void close();
+};
+
+class TrSnapshot {
+private:
+    TrModuleInfo info;
+    std::vector<TrSnapshotRegion> regions;
+
+    friend class TrSnapshotStore;
+public:
+    // Load snapshot, throws exception if the file or hash of any region is invalid
+    void load(std::string name);
+
+    const TrModuleInfo& getModuleInfo() const { return info; }
+    typedef std::vector<TrSnapshotRegion>::const_iterator const_iterator;
+    const_iterator begin() const { return regions.begin(); }
+    const_iterator end() const { return regions.end(); }
+};
+
+#endif // __TRSNAPSHOT_H__
@@ -0,0 +1,102 @@
+/*
+ * Deduplicating store of TR snapshots.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRSNAPSHOTSTORE_H__
+#define __TRSNAPSHOTSTORE_H__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <cstdint>
+
+#include <TrTypes.h>
+#include <TrHash.h>
+#include <TrSnapshot.h>
+
+// Block which differs between two snapshots, at device address
+struct TrSnapshotChange {
+    TrTarget target;
+    unsigned int addr;
+    TrSnapshotChange(TrTarget t, unsigned int a) : target(t), addr(a) {}
+};
+
+// Region of snapshot manifest, blocks are referenced by keys of the store
+struct TrManifestRegion {
+    TrTarget target;
+    unsigned int addr;
+    unsigned int step;
+    size_t blockLen;
+    uint64_t hash;      // Hash of all blocks
+    std::vector<uint64_t> blocks;
+    TrManifestRegion() : target(TrTarget::CFG), addr(0), step(0), blockLen(0), hash(0) {}
+};
+
+struct TrManifest {
+    TrModuleInfo info;
+    std::vector<TrManifestRegion> regions;
+};
+
+/*
+ * Directory with one pack file of unique blocks and a manifest per snapshot.
+ * Blocks downloaded from TRs are stored once however many snapshots contain
+ * them, the pack is only appended. Blocks of the pack are kept in memory.
+ */
+class TrSnapshotStore {
+private:
+    std::string dir;
+    std::basic_string<unsigned char> pack;
+    // Offset of block in the pack by its key. Key is hash of the content,
+    // colliding blocks take the next free key. Keys are assigned in the order
+    // of the pack, so they are the same after the pack is loaded again.
+    std::unordered_map<uint64_t, size_t> index;
+    std::ofstream packFile;
+
+    std::string getManifestName(const std::string& name) const;
+    // Key of stored block with the same content, or free key for the block
+    uint64_t findKey(const unsigned char* data, size_t len, bool& found) const;
+public:
+    // Open store in existing directory, blocks of the pack are loaded
+    TrSnapshotStore(std::string directory);
+
+    // Store block, returns its key
+    uint64_t putBlock(const std::basic_string<unsigned char>& data);
+    // Write blocks appended by putBlock to the pack file
+    void flush();
+    // Write manifest of snapshot, its blocks must be stored
+    void putManifest(std::string name, const TrManifest& manifest);
+    void getManifest(std::string name, TrManifest& manifest) const;
+
+    // Store loaded snapshot
+    void put(std::string name, const TrSnapshot& snapshot);
+    // Assemble snapshot from its blocks, throws exception if any block is
+    // missing or hash of any region does not match
+    void get(std::string name, TrSnapshot& snapshot) const;
+    // Blocks which differ between two snapshots, compared by manifests only.
+    // All blocks of regions missing in one of the snapshots differ.
+    void diff(std::string a, std::string b, std::vector<TrSnapshotChange>& changes) const;
+
+    size_t getBlockCount() const { return index.size(); }
+};
+
+// Writes snapshot into the store as the blocks are downloaded
+class TrSnapshotStoreWriter : public TrSnapshotSink {
+private:
+    TrSnapshotStore& store;
+    std::string name;
+    TrManifest manifest;
+    TrHash hash;
+public:
+    TrSnapshotStoreWriter(TrSnapshotStore& s, std::string n, const TrModuleInfo& info);
+    // Blocks of the fill pattern are stored once as any other block, elision is ignored
+    void beginRegion(TrTarget target, unsigned int addr, unsigned int step, bool = false, uint16_t = 0);
+    void writeBlock(const std::basic_string<unsigned char>& data);
+    void endRegion();
+    // Write manifest, the snapshot is in the store since then
+    void close();
+};
+
+#endif // __TRSNAPSHOTSTORE_H__
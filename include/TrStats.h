@@ -0,0 +1,75 @@
+/*
+ * Transfer statistics of TR interface.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRSTATS_H__
+#define __TRSTATS_H__
+
+#include <array>
+#include <cstdint>
+
+#include <TrTypes.h>
+
+/*
+ * HDR-style latency histogram. Values are in microseconds. Values below 32us
+ * are recorded exactly, larger values fall into power of two ranges split
+ * into 16 linear sub-buckets, i.e. the relative error is at most 1/16.
+ */
+class TrHistogram {
+public:
+    static const unsigned int SUB_BITS = 4;
+    static const unsigned int SUB_COUNT = 1 << SUB_BITS;
+    static const size_t BUCKET_COUNT = (32 - SUB_BITS + 1) * SUB_COUNT;
+private:
+    std::array<uint64_t, BUCKET_COUNT> buckets;
+    uint64_t cnt;
+    uint64_t sum;
+    uint32_t minValue;
+    uint32_t maxValue;
+
+    static size_t getIndex(uint32_t value);
+    static uint32_t getValue(size_t index);
+public:
+    TrHistogram() { reset(); }
+    void reset();
+    void record(uint32_t value);
+    uint64_t count() const { return cnt; }
+    uint64_t total() const { return sum; }
+    uint32_t min() const { return cnt ? minValue : 0; }
+    uint32_t max() const { return maxValue; }
+    double mean() const { return cnt ? static_cast<double>(sum) / cnt : 0; }
+    // Value at percentile (0 - 100), reported as the lower bound of its bucket
+    uint32_t percentile(double p) const;
+};
+
+// Counters of one programming target
+struct TrTargetStats {
+    uint64_t uploads;
+    uint64_t downloads;
+    uint64_t uploadBytes;
+    uint64_t downloadBytes;
+    TrHistogram latency;
+    TrTargetStats() : uploads(0), downloads(0), uploadBytes(0), downloadBytes(0) {}
+};
+
+// Snapshot of transfer statistics
+class TrStats {
+private:
+    std::array<TrTargetStats, TR_TARGET_COUNT> targets;
+    TrHistogram enterMode;
+    TrHistogram terminateMode;
+public:
+    const TrTargetStats& get(TrTarget target) const { return targets[static_cast<size_t>(target)]; }
+    // Time spent in entering and terminating of programming mode
+    const TrHistogram& getEnterMode() const { return enterMode; }
+    const TrHistogram& getTerminateMode() const { return terminateMode; }
+
+    void recordUpload(unsigned char target, size_t len, uint32_t us);
+    void recordDownload(unsigned char target, size_t len, uint32_t us);
+    void recordEnterMode(uint32_t us) { enterMode.record(us); }
+    void recordTerminateMode(uint32_t us) { terminateMode.record(us); }
+};
+
+#endif // __TRSTATS_H__
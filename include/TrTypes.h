@@ -7,6 +7,8 @@
 #ifndef __TRTYPES_H__
 #define __TRTYPES_H__
 
+#include <cstddef>
+
 enum class TrMemory {
     ERROR,
     FLASH,
@@ -14,6 +16,21 @@ enum class TrMemory {
     EXTERNAL_EEPROM
 };
 
+// Programming targets, values are the target codes of the TR programming protocol
+enum class TrTarget {
+    CFG,
+    RFPMG,
+    RFBAND,
+    ACCESS_PWD,
+    USER_KEY,
+    FLASH,
+    INTERNAL_EEPROM,
+    EXTERNAL_EEPROM,
+    SPECIAL
+};
+
+static const size_t TR_TARGET_COUNT = 9;
+
 enum class TrMcu {
     NONE,
     PIC16F1938
@@ -27,8 +44,10 @@ enum class TrSerie {
 
 typedef unsigned char TrOsVersion;
 typedef unsigned int  TrOsBuild;
+typedef unsigned int  TrSerial;
 
 struct TrModuleInfo {
+    TrSerial    serial;     // Module ID
     TrMcu       mcu;
     TrSerie     serie;
     TrOsVersion osVersion;
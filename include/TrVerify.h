@@ -0,0 +1,49 @@
+/*
+ * Read back verification of programmed TR memory.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRVERIFY_H__
+#define __TRVERIFY_H__
+
+#include <string>
+
+#include <TrTypes.h>
+
+enum class TrVerifyMode {
+    // No verification
+    NONE,
+    // Every written block is read back after the upload of the file
+    FULL,
+    // Given percentage of blocks is read back after the upload of the file
+    SAMPLED,
+    // Written blocks are collected and read back at once by TrIfc::verify()
+    DEFERRED
+};
+
+/*
+ * Written block. HEX blocks have HEX file address, configuration and RFPMG
+ * have address 0.
+ */
+struct TrVerifyBlock {
+    TrTarget target;
+    unsigned int addr;
+    std::basic_string<unsigned char> data;
+    TrVerifyBlock(TrTarget t, unsigned int a, const std::basic_string<unsigned char>& d) : target(t), addr(a), data(d) {}
+};
+
+// Block which was read back with different content
+struct TrMismatch {
+    TrTarget target;
+    unsigned int addr;
+    std::basic_string<unsigned char> expected;
+    std::basic_string<unsigned char> actual;
+    TrMismatch(const TrVerifyBlock& b, const std::basic_string<unsigned char>& a) : target(b.target), addr(b.addr), expected(b.data), actual(a) {}
+};
+
+// Blocks are sampled by hash of their address, so the same blocks are
+// selected every time and the selection is spread over the memory
+bool isTrBlockSampled(TrTarget target, unsigned int addr, unsigned int percent);
+
+#endif // __TRVERIFY_H__
@@ -0,0 +1,36 @@
+/*
+ * Write back buffer of small eeprom writes.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TRWRITEBACK_H__
+#define __TRWRITEBACK_H__
+
+#include <map>
+#include <string>
+
+#include <TrTypes.h>
+
+/*
+ * Pending writes per eeprom as disjoint runs of bytes. Overlapping and
+ * adjacent writes are merged into one run, later writes win.
+ */
+class TrWriteBack {
+public:
+    typedef std::map<unsigned int, std::basic_string<unsigned char>> Runs;
+private:
+    Runs internal;
+    Runs external;
+
+    Runs& getRuns(TrMemory memory);
+public:
+    void add(TrMemory memory, unsigned int addr, const std::basic_string<unsigned char>& data);
+    // Copy pending bytes into block at address, returns number of copied bytes
+    size_t overlay(TrMemory memory, unsigned int addr, std::basic_string<unsigned char>& block) const;
+    const Runs& getRuns(TrMemory memory) const;
+    bool empty() const { return internal.empty() && external.empty(); }
+    void clear() { internal.clear(); external.clear(); }
+};
+
+#endif // __TRWRITEBACK_H__
@@ -11,6 +11,8 @@
 #include <string>
 #include <array>
 
+#include <TrError.h>
+
 class TrconfFmtParser {
 private:
     std::string file_name;
@@ -21,6 +23,10 @@ public:
     TrconfFmtParser(std::string name) : file_name(name) {parsed = false;}
     void parse();
     void checkChannels(unsigned char rfband);
+    // Check channels of configuration data, name is used in error messages
+    static void checkChannels(unsigned char rfband, const std::basic_string<unsigned char>& data, const std::string& name);
+    // Check channels of configuration data without exceptions
+    static TrError validateChannels(unsigned char rfband, const std::basic_string<unsigned char>& data);
     unsigned char getRFPMG(void);
     std::basic_string<unsigned char> getData(void);
 };
@@ -24,13 +24,13 @@ const size_t TR_LINE_LEN_MAX = 32; // Maximal write data length
 
 const size_t TR_MEMORY_SIZE = 65536; // Maximal memory size of TR - 16b addressing
 
-bool verify_record_csum(const std::string& str) {
+bool verify_record_csum(string_span str) {
     size_t len = str.length() - 1;
     unsigned int sum = 0;
     
-    std::string data = str.substr(1, len);
+    string_span data = str.substr(1, len);
     for (int i = 0; i < len / 2; i++) {
-        sum += std::stoul(data.substr(i * 2, 2), nullptr, 16);
+        sum += hex_value(data.substr(i * 2, 2));
     }
     
     return (sum & 0xff) == 0;
@@ -43,12 +43,13 @@ void generateRecordCsum(std::basic_string<unsigned char> &str) {
     for (itr = str.begin(); itr != str.end(); itr++) {
         sum += *itr;
     }
-    sum = (~sum) & 0xff;
+    // Two's complement, sum of all bytes of the record is 0
+    sum = (~sum + 1) & 0xff;
     str.push_back(sum);
 }
 
 
-void HexFmtParser::parse() {
+void HexFmtParser::parseFile() {
     std::string line;
     std::ifstream infile(file_name);
     size_t line_no = 0;
@@ -58,6 +59,7 @@ void HexFmtParser::parse() {
     std::array<unsigned char, TR_MEMORY_SIZE> prgData;
     std::array<bool, TR_MEMORY_SIZE> prgDataValid;
     
+    notes.clear();
     
     while (std::getline(infile, line))
     {
@@ -68,13 +70,14 @@ void HexFmtParser::parse() {
         size_t data_len;
         unsigned char type;
         std::basic_string<unsigned char> data;
+        string_span record;
         
         line_no++;
         
         // Trim whitespace
-        line = trim(line);
+        record = trim(line);
      
-        len = line.length();
+        len = record.length();
         
         // Skip empty line
         if (len == 0)
@@ -101,26 +104,26 @@ void HexFmtParser::parse() {
         }
         
         // Check for invalid characters
-        if ((position = line.find_first_not_of(":0123456789abcdefABCDEF")) != std::string::npos) {
+        if ((position = record.find_first_not_of(":0123456789abcdefABCDEF")) != string_span::npos) {
             TR_THROW_FMT_EXCEPTION(file_name, line_no, position, "Invalid length character in hex file!");
         }
         
         // Check for record start code
-        if (line[0] != ':') {
+        if (record[0] != ':') {
             TR_THROW_FMT_EXCEPTION(file_name, line_no, 1, "Missing record start code : in hex file!");
         }
         
         // Check checksum
-        if (!verify_record_csum(line)) {
+        if (!verify_record_csum(record)) {
             TR_THROW_FMT_EXCEPTION(file_name, line_no, len - 2, "Invalid checksum of record in hex file!");
         }
         
         // Get length
-        data_len = std::stoul(line.substr(1, 2), nullptr, 16);
+        data_len = hex_value(record.substr(1, 2));
         // Get offset
-        offset = std::stoul(line.substr(3, 4), nullptr, 16);
+        offset = hex_value(record.substr(3, 4));
         // Get type
-        type = std::stoul(line.substr(7, 2), nullptr, 16);
+        type = hex_value(record.substr(7, 2));
         
         // Check data length of record
         if (2 * data_len + 11 != len) {
@@ -130,8 +133,8 @@ void HexFmtParser::parse() {
         switch(type) {
             case 0:
                 // Data record
-                for (size_t i = 0; i < data_len / 2; i++) {
-                    data.push_back(std::stoul(line.substr(9 + i * 2, 2), nullptr, 16));
+                for (size_t i = 0; i < data_len; i++) {
+                    data.push_back(hex_value(record.substr(9 + i * 2, 2)));
                 }
                 addr = base + offset;
                 variableLines.push_back(HexDataRecord(addr, data));
@@ -148,30 +151,28 @@ void HexFmtParser::parse() {
                 if (data_len != 2) {
                     TR_THROW_FMT_EXCEPTION(file_name, line_no, 2, "Data length of Extended Segment Address record in hex file must be 2!");
                 }
-                base = std::stoul(line.substr(9, 4), nullptr, 16) * 16;
+                base = hex_value(record.substr(9, 4)) * 16;
                 break;
             case 3:
                 // Start Segment Address record
                 if (data_len != 4) {
                     TR_THROW_FMT_EXCEPTION(file_name, line_no, 2, "Data length of Start Segment Address record in hex file must be 4!");
                 }
-                std::cerr << "Warning: Start Segment Address record (type 03) on line " << line_no << " is ignored!\n";
-                std::cerr << "         This type of record has no effect on IQRF TR device.\n";
+                notes.push_back(TrNote(TrSeverity::WARNING, file_name, line_no, "Start Segment Address record (type 03) on line " + std::to_string(line_no) + " is ignored! This type of record has no effect on IQRF TR device."));
                 break;
             case 4:
                 // Extended Linear Address record
                 if (data_len != 2) {
                     TR_THROW_FMT_EXCEPTION(file_name, line_no, 2, "Data length of Extended Linear Address record in hex file must be 2!");
                 }
-                base = std::stoul(line.substr(9, 4), nullptr, 16) << 16;
+                base = hex_value(record.substr(9, 4)) << 16;
                 break;
             case 5:
                 // Start Linear Address record
                 if (data_len != 4) {
                     TR_THROW_FMT_EXCEPTION(file_name, line_no, 2, "Data length of Start Linear Address record in hex file must be 4!");
                 }
-                std::cerr << "Warning: Start Linear Address record (type 05) on line " << line_no << " is ignored!\n";
-                std::cerr << "         This type of record has no effect on IQRF TR device.";
+                notes.push_back(TrNote(TrSeverity::WARNING, file_name, line_no, "Start Linear Address record (type 05) on line " + std::to_string(line_no) + " is ignored! This type of record has no effect on IQRF TR device."));
                 break;
             default:
                 TR_THROW_FMT_EXCEPTION(file_name, line_no, 8, "Unknown type of record in hex file!\n");
@@ -230,33 +231,107 @@ void HexFmtParser::parse() {
     }
 }
 
+void HexFmtParser::parse() {
+    // Notes found before a format error are reported too
+    try {
+        parseFile();
+    } catch (...) {
+        reportNotes(listener, notes);
+        throw;
+    }
+    
+    reportNotes(listener, notes);
+}
+
 void HexFmtParser::pushBack(unsigned int addr, std::basic_string<unsigned char> data) {
     blines.push_back(HexDataRecord(addr, data));
 }
 
-void HexFmtParser::save() {
-    std::ofstream outfile(file_name);
-    int line_no = 0;
+void HexFmtParser::fill(unsigned int addr, size_t len, uint16_t pattern) {
+    static const size_t BLOCK_LEN = 32;
+    std::vector<HexDataRecord> records;
     std::vector<HexDataRecord>::iterator itr;
-    std::basic_string<unsigned char>::iterator strItr;
+    size_t pos = addr;
+    size_t end = addr + len;
     
-    for (itr = blines.begin(); itr != blines.end(); itr++) {
-        line_no++;
-        if ((*itr).addr >= TR_MEMORY_SIZE) {
-            TR_THROW_FMT_EXCEPTION(file_name, line_no, 0, "Invalid address for I8HEX mode! I32HEX mode is currently unsupported for download.\n");
+    std::stable_sort(blines.begin(), blines.end(), [](const HexDataRecord& a, const HexDataRecord& b) {
+        return a.addr < b.addr;
+    });
+    
+    itr = blines.begin();
+    while (pos < end) {
+        // Skip records covering the position
+        while ((itr != blines.end()) && ((*itr).addr <= pos)) {
+            pos = std::max(pos, static_cast<size_t>((*itr).addr + (*itr).data.length()));
+            records.push_back(*itr);
+            itr++;
         }
-        std::basic_string<unsigned char> data;
-        data.push_back((*itr).data.size());
-        data.push_back(((*itr).addr >> 8) & 0xff);
-        data.push_back((*itr).addr & 0xff);
-        data.push_back(0);
-        data += (*itr).data;
-        generateRecordCsum(data);
-        outfile << ":";
-        for (strItr = data.begin(); strItr != data.end(); strItr++) {
-            outfile << std::setw(2) << std::setfill ('0') << std::hex << static_cast<int>(*strItr);
+        if (pos >= end) {
+            break;
         }
-        outfile << "\n";
+        
+        // Gap ends at the next record, the end of range or the end of block
+        size_t next = std::min(end, addr + ((pos - addr) / BLOCK_LEN + 1) * BLOCK_LEN);
+        if (itr != blines.end()) {
+            next = std::min(next, static_cast<size_t>((*itr).addr));
+        }
+        
+        std::basic_string<unsigned char> data(next - pos, 0);
+        for (size_t i = pos; i < next; i++) {
+            data[i - pos] = (i % 2 == 0) ? (pattern & 0xff) : (pattern >> 8);
+        }
+        records.push_back(HexDataRecord(pos, data));
+        pos = next;
     }
+    
+    records.insert(records.end(), itr, blines.end());
+    blines.swap(records);
+}
+
+void HexFmtParser::save() {
+    HexFmtWriter writer(file_name);
+    std::vector<HexDataRecord>::iterator itr;
+    
+    for (itr = blines.begin(); itr != blines.end(); itr++) {
+        writer.write((*itr).addr, (*itr).data);
+    }
+    writer.close();
+}
+
+void HexFmtWriter::write(unsigned int addr, const std::basic_string<unsigned char>& data) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    std::basic_string<unsigned char> record;
+    std::basic_string<unsigned char>::iterator itr;
+    
+    line_no++;
+    if (addr >= TR_MEMORY_SIZE) {
+        TR_THROW_FMT_EXCEPTION(file_name, line_no, 0, "Invalid address for I8HEX mode! I32HEX mode is currently unsupported for download.\n");
+    }
+    
+    record.push_back(data.size());
+    record.push_back((addr >> 8) & 0xff);
+    record.push_back(addr & 0xff);
+    record.push_back(0);
+    record += data;
+    generateRecordCsum(record);
+    
+    // Line is formatted at once, it is written for every downloaded block
+    line.assign(1, ':');
+    for (itr = record.begin(); itr != record.end(); itr++) {
+        line += HEX_DIGITS[*itr >> 4];
+        line += HEX_DIGITS[*itr & 0x0f];
+    }
+    line += '\n';
+    if (!outfile.write(line.data(), line.length())) {
+        TR_THROW_EXCEPTION(TrException, "Can not write HEX file " + file_name + "!");
+    }
+}
+
+void HexFmtWriter::close() {
     outfile << ":00000001FF\n";
+    // Failed write of the end record stays flagged, close writes buffered records
+    outfile.close();
+    if (!outfile) {
+        TR_THROW_EXCEPTION(TrException, "Can not write HEX file " + file_name + "!");
+    }
 }
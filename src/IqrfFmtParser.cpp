@@ -9,7 +9,8 @@
 #include <iostream>
 #include <array>
 #include <map>
-#include <locale>
+#include <iterator>
+#include <utility>
 
 #include "string_operations.h"
 #include "IqrfFmtParser.h"
@@ -17,44 +18,38 @@
 
 const size_t LINE_LEN = 40;
 
-static bool isCommentHeader(const std::string& str) {
-    size_t pos = str.find_first_of('#');
-    if (str[pos + 1] == '$') {
+static bool isCommentHeader(string_span str) {
+    size_t pos = str.find_first_of("#");
+    if ((pos != string_span::npos) && (pos + 1 < str.length()) && (str[pos + 1] == '$')) {
         return true;
     } else {
         return false;
     }
 }
 
-static std::string getHeader(const std::string& str) {
-    size_t pos = str.find_first_of('#');
-    size_t last = str.length() - 1;
-    int i;
-    std::locale loc;
+// Header follows #$, trailing whitespace is removed
+static string_span getHeader(string_span str) {
+    size_t pos = str.find_first_of("#");
+    string_span header = str.substr(pos + 2);
+    size_t last = header.find_last_not_of(" \t\r\n\v\f");
     
-    for (i = last; i >= 0; i--) {
-        if (!std::isspace(str[i], loc)) {
-            break;
-        }
-    }
-    
-    return str.substr(pos + 2, i - (pos + 2) + 1);
+    return header.substr(0, (last == string_span::npos) ? 0 : last + 1);
 }
 
-static std::string stripLineCounter(const std::string& str) {
+static string_span stripLineCounter(string_span str) {
     return str.substr(0, str.length() - 4);
 }
 
-static int getLineCounter(const std::string& str) {
-    return std::stoi(str.substr(str.length() - 4), nullptr, 16);
+static int getLineCounter(string_span str) {
+    return hex_value(str.substr(str.length() - 4));
 }
 
-void IqrfPrgHeader::add(std::string line) {
+void IqrfPrgHeader::add(const std::string& line, std::vector<TrNote>& notes, const std::string& file, size_t line_no) {
     if (!isCommentHeader(line)) {
         return;
     }
     
-    std::string header = getHeader(line);
+    string_span header = getHeader(line);
     
     index++;
     switch (index) {
@@ -84,113 +79,122 @@ void IqrfPrgHeader::add(std::string line) {
             break;
         }
         case 2: {
-            std::vector<std::string>::iterator itr;
-            std::vector<std::string> parts = tokenize(header, ";");
+            tokenizer parts(header, ";");
+            string_span part;
             TrOsVersion osVersion;
-            for (itr = parts.begin(); itr != parts.end(); itr++) {
-                switch ((*itr).length()) {
+            while (parts.next(part)) {
+                if (!is_hex(part)) {
+                    TR_THROW_EXCEPTION(TrException, "Mallformed OS version and build record in second programming header! Offending value is: " + part.str() + "");
+                }
+                switch (part.length()) {
                     case 2: {
-                        osVersion = std::stoul(*itr, nullptr, 16);
+                        osVersion = hex_value(part);
                         std::pair<TrOsBuild, TrOsBuild> osBuild(0, 0xffff);
                         supportedOs.insert(std::pair<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>>(osVersion, osBuild));
                         break;
                     }
                     case 6: {
-                        osVersion = std::stoul((*itr).substr(0, 2), nullptr, 16);
-                        TrOsBuild build = std::stoul((*itr).substr(2, 4), nullptr, 16);
+                        osVersion = hex_value(part.substr(0, 2));
+                        TrOsBuild build = hex_value(part.substr(2, 4));
                         std::pair<TrOsBuild, TrOsBuild> osBuild(build, build);
                         supportedOs.insert(std::pair<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>>(osVersion, osBuild));
                         break;
                     }
                     case 10: {
-                        osVersion = std::stoul((*itr).substr(0, 2), nullptr, 16);
-                        TrOsBuild buildMin = std::stoul((*itr).substr(2, 4), nullptr, 16);
-                        TrOsBuild buildMax = std::stoul((*itr).substr(6, 4), nullptr, 16);
+                        osVersion = hex_value(part.substr(0, 2));
+                        TrOsBuild buildMin = hex_value(part.substr(2, 4));
+                        TrOsBuild buildMax = hex_value(part.substr(6, 4));
                         std::pair<TrOsBuild, TrOsBuild> osBuild(buildMin, buildMax);
                         supportedOs.insert(std::pair<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>>(osVersion, osBuild));
                         break;
                     }
                     default:
-                        TR_THROW_EXCEPTION(TrException, "Mallformed OS version and build record in second programming header! Offending value is: " + (*itr) + "");
+                        TR_THROW_EXCEPTION(TrException, "Mallformed OS version and build record in second programming header! Offending value is: " + part.str() + "");
                         break;
                 }
             }
             break;
         }
         case 3:
-            std::cerr << "Note: Build date & time: " << header << "\n";
+            notes.push_back(TrNote(TrSeverity::NOTE, file, line_no, "Build date & time: " + header.str()));
             break;
         case 4:
-            std::cerr << "Note: Description: " << header << "\n";
+            notes.push_back(TrNote(TrSeverity::NOTE, file, line_no, "Description: " + header.str()));
             break;
         default:
-            std::cerr << "Warning: Unrecognized programming header: \n" << "[" << index << "] " << header << " is ignored!\n"; 
+            notes.push_back(TrNote(TrSeverity::WARNING, file, line_no, "Unrecognized programming header: [" + std::to_string(index) + "] " + header.str() + " is ignored!"));
             break;
     }
 }
 
-bool IqrfPrgHeader::check(TrModuleInfo& info) {
-    std::map<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>>::iterator itr;
+TrError IqrfPrgHeader::validate(const TrModuleInfo& info) const {
+    std::map<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>>::const_iterator itr;
     if (mcu != info.mcu) {
-        return false;
+        return TrError(TrErrorCode::UNSUPPORTED_TR, TR_ERROR_LOCATION);
     }
     if (serie != info.serie) {
-        return false;
+        return TrError(TrErrorCode::UNSUPPORTED_TR, TR_ERROR_LOCATION);
     }
     itr = supportedOs.find(info.osVersion);
     if (itr == supportedOs.end()) {
-        return false;
+        return TrError(TrErrorCode::UNSUPPORTED_OS, TR_ERROR_LOCATION);
     }
     if (info.osBuild < (*itr).second.first) {
-        return false;
+        return TrError(TrErrorCode::UNSUPPORTED_OS, TR_ERROR_LOCATION);
     }
     if (info.osBuild > (*itr).second.second) {
-        return false;
+        return TrError(TrErrorCode::UNSUPPORTED_OS, TR_ERROR_LOCATION);
     }
-    return true;
+    return TrError();
 }
 
-void IqrfFmtParser::parse() {
-    std::string line;
+void IqrfFmtParser::parseFile() {
     std::ifstream infile(file_name);
+    std::string content((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+    string_span line;
+    size_t next = 0;
     size_t line_no = 0;
     size_t position;
     size_t len;
     int last_cnt = -1;
     int cnt;
     
-    while (std::getline(infile, line))
+    notes.clear();
+    
+    // Lines are viewed in place in the file content
+    while (next_line(content, next, line))
     {
         std::basic_string<unsigned char> bdata;
+        string_span record;
         
         line_no++;
         
         // Check for programming header in comments
         if (isCommentHeader(line)) {
-            prgHeader.add(line);
+            prgHeader.add(line.str(), notes, file_name, line_no);
             continue;
         }
         
         // Remove comments and trim whitespace
-        line = trim(uncomment(line));
+        record = trim(uncomment(line));
         
         // Skip empty line
-        if (line.length() == 0)
+        if (record.length() == 0)
             continue;
-        
-        // Get line counter
-        cnt = getLineCounter(line);
                 
         // Every line in iqrf file which is not a comment has exactly LINE_LEN (40) chars
-        if (line.length() != LINE_LEN) {
+        if (record.length() != LINE_LEN) {
             TR_THROW_FMT_EXCEPTION(file_name, line_no, 0, "Invalid line length in iqrf file - expected 36!");
         }
         
         // Check for invalid characters
-        if ((position = line.find_first_not_of("0123456789abcdefABCDEF")) != std::string::npos) {
+        if ((position = record.find_first_not_of("0123456789abcdefABCDEF")) != string_span::npos) {
             TR_THROW_FMT_EXCEPTION(file_name,  line_no, position, "Invalid character in iqrf file!");
         }
         
+        // Get line counter
+        cnt = getLineCounter(record);
+        
         // Check line counter sequence
         if (last_cnt + 1 != cnt) {
             TR_THROW_FMT_EXCEPTION(file_name, line_no, 0, "Invalid line counter sequence!");
@@ -198,14 +202,28 @@ void IqrfFmtParser::parse() {
             last_cnt = cnt;
         }
         
-        bdata.resize(LINE_LEN / 2);
+        // Line counter is not part of the uploaded data
+        record = stripLineCounter(record);
+        bdata.resize(record.length() / 2);
         
         // Convert hexadecimal values to bytes
-        for (int i = 0; i < LINE_LEN / 2; i++) {
-            bdata[i] = std::stoul(line.substr(i * 2, 2), nullptr, 16);
+        for (int i = 0; i < record.length() / 2; i++) {
+            bdata[i] = hex_value(record.substr(i * 2, 2));
         }
         
         // Store data
-        blines.push_back(bdata);
+        blines.push_back(std::move(bdata));
     }
 }
+
+void IqrfFmtParser::parse() {
+    // Notes found before a format error are reported too
+    try {
+        parseFile();
+    } catch (...) {
+        reportNotes(listener, notes);
+        throw;
+    }
+    
+    reportNotes(listener, notes);
+}
@@ -0,0 +1,57 @@
+/*
+ * Cache of blocks downloaded from TR memory.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <algorithm>
+
+#include <TrBlockCache.h>
+
+// Longest downloaded block, blocks starting before the uploaded data by
+// more than this can not overlap it
+static const unsigned int BLOCK_LEN_MAX = 64;
+
+bool TrBlockCache::find(TrTarget target, unsigned int addr, std::basic_string<unsigned char>& data) {
+    std::map<std::pair<TrTarget, unsigned int>, std::basic_string<unsigned char>>::iterator itr;
+
+    itr = blocks.find(std::make_pair(target, addr));
+    if (itr == blocks.end()) {
+        misses++;
+        return false;
+    }
+
+    hits++;
+    data = (*itr).second;
+    return true;
+}
+
+void TrBlockCache::store(TrTarget target, unsigned int addr, const std::basic_string<unsigned char>& data) {
+    blocks[std::make_pair(target, addr)] = data;
+}
+
+void TrBlockCache::update(TrTarget target, unsigned int addr, const unsigned char* data, size_t len) {
+    std::map<std::pair<TrTarget, unsigned int>, std::basic_string<unsigned char>>::iterator itr;
+    unsigned int first = (addr > BLOCK_LEN_MAX) ? addr - BLOCK_LEN_MAX : 0;
+    unsigned int end = addr + len;
+
+    for (itr = blocks.lower_bound(std::make_pair(target, first)); itr != blocks.end(); itr++) {
+        unsigned int base = (*itr).first.second;
+        std::basic_string<unsigned char>& block = (*itr).second;
+
+        if (((*itr).first.first != target) || (base >= end)) {
+            break;
+        }
+
+        // Copy the overlapping part
+        unsigned int from = std::max(base, addr);
+        unsigned int to = std::min(static_cast<unsigned int>(base + block.length()), end);
+        for (unsigned int i = from; i < to; i++) {
+            block[i - base] = data[i - addr];
+        }
+    }
+}
+
+void TrBlockCache::invalidate(TrTarget target) {
+    blocks.erase(blocks.lower_bound(std::make_pair(target, 0u)), blocks.upper_bound(std::make_pair(target, ~0u)));
+}
@@ -0,0 +1,68 @@
+/*
+ * Checkpoint journal of resumable TR programming sessions.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+
+#include <TrException.h>
+#include <TrCheckpoint.h>
+#include "binary_operations.h"
+
+static const char CHECKPOINT_MAGIC[4]         = {'T', 'R', 'C', 'K'};
+static const unsigned char CHECKPOINT_VERSION = 1;
+static const size_t CHECKPOINT_LEN            = 24;
+
+bool TrCheckpoint::load(TrCheckpointData& data) {
+    char buffer[CHECKPOINT_LEN];
+    unsigned char *bptr = reinterpret_cast<unsigned char*>(buffer);
+    std::ifstream infile(file_name, std::ios::binary);
+
+    if (!infile.read(buffer, CHECKPOINT_LEN)) {
+        return false;
+    }
+
+    if (!std::equal(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + 4, buffer) || (bptr[4] != CHECKPOINT_VERSION)) {
+        return false;
+    }
+
+    data.target = static_cast<TrCheckpointTarget>(bptr[5]);
+    data.hash = getValue(bptr + 8, 8);
+    data.blocks = getValue(bptr + 16, 4);
+    data.next = getValue(bptr + 20, 4);
+
+    return data.next <= data.blocks;
+}
+
+void TrCheckpoint::save(const TrCheckpointData& data) {
+    char buffer[CHECKPOINT_LEN] = {0};
+    unsigned char *bptr = reinterpret_cast<unsigned char*>(buffer);
+
+    std::copy_n(CHECKPOINT_MAGIC, 4, buffer);
+    bptr[4] = CHECKPOINT_VERSION;
+    bptr[5] = static_cast<unsigned char>(data.target);
+    putValue(bptr + 8, data.hash, 8);
+    putValue(bptr + 16, data.blocks, 4);
+    putValue(bptr + 20, data.next, 4);
+
+    if (!file.is_open()) {
+        file.open(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+    }
+
+    // Journal has fixed size, rewrite it in place
+    file.seekp(0);
+    if (!file.write(buffer, CHECKPOINT_LEN) || !file.flush()) {
+        TR_THROW_EXCEPTION(TrException, "Can not write checkpoint journal " + file_name + "!");
+    }
+}
+
+void TrCheckpoint::remove() {
+    if (file.is_open()) {
+        file.close();
+    }
+    std::remove(file_name.c_str());
+}
@@ -0,0 +1,213 @@
+/*
+ * Precompiled command stream of programming job.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <TrException.h>
+#include <TrHash.h>
+#include <TrCommandStream.h>
+#include <TrIfc.h>
+#include "binary_operations.h"
+#include "tr_protocol.h"
+
+static const char STREAM_MAGIC[4]       = {'T', 'R', 'C', 'S'};
+static const size_t STREAM_HEADER_LEN   = 24;
+static const size_t COMMAND_HEADER_LEN  = 4;
+static const size_t OS_RECORD_LEN       = 5;
+
+static uint64_t hashStream(TrMcu mcu, TrSerie serie, const std::basic_string<unsigned char>& body) {
+    TrHash hash;
+
+    hash.update(static_cast<unsigned int>(TR_COMMAND_STREAM_VERSION));
+    hash.update(static_cast<unsigned int>(mcu));
+    hash.update(static_cast<unsigned int>(serie));
+    hash.update(body);
+    return hash.digest();
+}
+
+void TrCommandStream::add(TrCommandOp op, TrTarget target, const std::basic_string<unsigned char>& data) {
+    commands.push_back(TrCommand(op, target, data));
+}
+
+std::basic_string<unsigned char> TrCommandStream::serialize() const {
+    std::basic_string<unsigned char> body;
+
+    for (const_iterator itr = begin(); itr != end(); itr++) {
+        body += static_cast<unsigned char>((*itr).op);
+        body += static_cast<unsigned char>((*itr).target);
+        appendValue(body, (*itr).data.length(), 2);
+        body += (*itr).data;
+    }
+    return body;
+}
+
+void TrCommandStream::compile(TrJob& job, const TrMemoryMap& map) {
+    std::basic_string<unsigned char> none;
+    TrJob::hex_iterator itr;
+
+    if (!job.isParsed()) {
+        job.parse();
+    }
+
+    mcu = map.mcu;
+    serie = map.serie;
+    commands.clear();
+    name.clear();
+
+    // Compatibility of IQRF plugin is checked before programming mode is entered
+    if (job.getIqrf()) {
+        const IqrfPrgHeader& header = job.getIqrf()->getPrgHeader();
+        std::basic_string<unsigned char> os;
+
+        if ((header.getMcu() != mcu) || (header.getSerie() != serie)) {
+            TR_THROW_EXCEPTION(TrException, "IQRF file " + job.getIqrf()->getFileName() + " is not intended for TR type of the command stream!");
+        }
+
+        std::map<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>>::const_iterator os_itr;
+        for (os_itr = header.getSupportedOs().begin(); os_itr != header.getSupportedOs().end(); os_itr++) {
+            appendValue(os, (*os_itr).first, 1);
+            appendValue(os, (*os_itr).second.first, 2);
+            appendValue(os, (*os_itr).second.second, 2);
+        }
+        add(TrCommandOp::CHECK_OS, TrTarget::SPECIAL, os);
+    }
+
+    add(TrCommandOp::ENTER_PRG_MODE, TrTarget::CFG, none);
+
+    if (job.getTrconf()) {
+        TrconfFmtParser& trconf = *job.getTrconf();
+        TrError error = TrIfc::validateCfg(trconf.getData());
+        if (!error.isOk()) {
+            error.raise();
+        }
+        // RFBAND can be read only in programming mode
+        add(TrCommandOp::CHECK_RFBAND, TrTarget::RFBAND, trconf.getData());
+        add(TrCommandOp::UPLOAD, TrTarget::CFG, trconf.getData());
+        add(TrCommandOp::UPLOAD, TrTarget::RFPMG, std::basic_string<unsigned char>(1, trconf.getRFPMG()));
+    }
+
+    for (itr = job.hexBegin(); itr != job.hexEnd(); itr++) {
+        TrMemory memory = (*itr).memory;
+        TrTarget target = getMemoryTarget(memory);
+        HexFmtParser& parser = (*itr).parser;
+
+        for (HexFmtParser::iterator block = parser.begin(); block != parser.end(); block++) {
+            std::basic_string<unsigned char> msg;
+            // Address in Flash is in 16b words not in bytes
+            unsigned int addr = (memory == TrMemory::FLASH) ? (*block).addr / 2 : (*block).addr;
+            if (map.check(memory, TrDirection::UPLOAD, addr, (*block).data.length()) != TrMemoryCheck::OK) {
+                TR_THROW_EXCEPTION(TrException, "Block at address " + std::to_string((*block).addr) + " of HEX file does not fit into TR memory!");
+            }
+            appendValue(msg, addr, 2);
+            msg += (*block).data;
+            add(TrCommandOp::UPLOAD, target, msg);
+        }
+    }
+
+    if (job.getIqrf()) {
+        IqrfFmtParser& parser = *job.getIqrf();
+        for (IqrfFmtParser::iterator record = parser.begin(); record != parser.end(); record++) {
+            TrError error = TrIfc::validateSpecial(*record);
+            if (!error.isOk()) {
+                error.raise();
+            }
+            add(TrCommandOp::UPLOAD, TrTarget::SPECIAL, *record);
+        }
+    }
+
+    add(TrCommandOp::TERMINATE_PRG_MODE, TrTarget::CFG, none);
+
+    hash = hashStream(mcu, serie, serialize());
+}
+
+void TrCommandStream::load(std::string file_name) {
+    std::ifstream infile(file_name, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+    const unsigned char* buffer = reinterpret_cast<const unsigned char*>(content.data());
+    size_t pos = STREAM_HEADER_LEN;
+    size_t count;
+
+    if (!infile.good() && !infile.eof()) {
+        TR_THROW_EXCEPTION(TrException, "Can not read command stream " + file_name + "!");
+    }
+
+    if ((content.length() < STREAM_HEADER_LEN) || !std::equal(STREAM_MAGIC, STREAM_MAGIC + 4, content.begin())) {
+        TR_THROW_EXCEPTION(TrException, "File " + file_name + " is not a command stream!");
+    }
+
+    if (buffer[4] != TR_COMMAND_STREAM_VERSION) {
+        TR_THROW_EXCEPTION(TrException, "Unsupported version " + std::to_string(buffer[4]) + " of command stream " + file_name + "!");
+    }
+
+    if (getValue(buffer + 12, 4) != content.length() - STREAM_HEADER_LEN) {
+        TR_THROW_EXCEPTION(TrException, "Command stream " + file_name + " is truncated!");
+    }
+
+    mcu = static_cast<TrMcu>(buffer[5]);
+    serie = static_cast<TrSerie>(buffer[6]);
+    count = getValue(buffer + 8, 4);
+    hash = getValue(buffer + 16, 8);
+
+    if (hashStream(mcu, serie, std::basic_string<unsigned char>(buffer + STREAM_HEADER_LEN, content.length() - STREAM_HEADER_LEN)) != hash) {
+        TR_THROW_EXCEPTION(TrException, "Hash of command stream " + file_name + " does not match its content!");
+    }
+
+    commands.clear();
+    while (pos < content.length()) {
+        size_t len;
+        if (pos + COMMAND_HEADER_LEN > content.length()) {
+            TR_THROW_EXCEPTION(TrException, "Command stream " + file_name + " is damaged!");
+        }
+        len = getValue(buffer + pos + 2, 2);
+        if (pos + COMMAND_HEADER_LEN + len > content.length()) {
+            TR_THROW_EXCEPTION(TrException, "Command stream " + file_name + " is damaged!");
+        }
+        add(static_cast<TrCommandOp>(buffer[pos]), static_cast<TrTarget>(buffer[pos + 1]),
+            std::basic_string<unsigned char>(buffer + pos + COMMAND_HEADER_LEN, len));
+        pos += COMMAND_HEADER_LEN + len;
+    }
+
+    if (commands.size() != count) {
+        TR_THROW_EXCEPTION(TrException, "Command stream " + file_name + " is damaged!");
+    }
+
+    name = file_name;
+}
+
+void TrCommandStream::save(std::string file_name) const {
+    std::basic_string<unsigned char> body = serialize();
+    std::basic_string<unsigned char> header(STREAM_MAGIC, STREAM_MAGIC + 4);
+    std::ofstream outfile(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    header += TR_COMMAND_STREAM_VERSION;
+    header += static_cast<unsigned char>(mcu);
+    header += static_cast<unsigned char>(serie);
+    header += static_cast<unsigned char>(0);
+    appendValue(header, commands.size(), 4);
+    appendValue(header, body.length(), 4);
+    appendValue(header, hash, 8);
+
+    outfile.write(reinterpret_cast<const char*>(header.data()), header.length());
+    outfile.write(reinterpret_cast<const char*>(body.data()), body.length());
+    if (!outfile.flush()) {
+        TR_THROW_EXCEPTION(TrException, "Can not write command stream " + file_name + "!");
+    }
+}
+
+bool TrCommandStream::checkOs(const TrCommand& command, const TrModuleInfo& info) {
+    const unsigned char* record = command.data.data();
+
+    for (size_t i = 0; i + OS_RECORD_LEN <= command.data.length(); i += OS_RECORD_LEN) {
+        if ((record[i] == info.osVersion) && (info.osBuild >= getValue(record + i + 1, 2)) &&
+            (info.osBuild <= getValue(record + i + 3, 2))) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,191 @@
+/*
+ * CRC32C fingerprints of TR memory images and blocks.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TR_CRC_SSE42
+#include <nmmintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define TR_CRC_SSE42
+#include <intrin.h>
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#include <TrException.h>
+#include <TrCrc.h>
+
+// Reflected Castagnoli polynomial
+static const uint32_t CRC32C_POLY = 0x82f63b78;
+
+typedef uint32_t (*CrcFunction)(uint32_t crc, const unsigned char* data, size_t len);
+
+// Tables for slicing by 8 bytes, table[k][b] is CRC of byte b followed by k zero bytes
+struct CrcTable {
+    uint32_t table[8][256];
+
+    CrcTable() {
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t crc = b;
+            for (int i = 0; i < 8; i++) {
+                crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+            }
+            table[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; b++) {
+            for (int k = 1; k < 8; k++) {
+                table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+            }
+        }
+    }
+};
+
+static uint32_t crc32cScalar(uint32_t crc, const unsigned char* data, size_t len) {
+    static const CrcTable tables;
+    const uint32_t (*t)[256] = tables.table;
+
+    for (; len >= 8; data += 8, len -= 8) {
+        uint32_t low = crc ^ (data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24));
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+              t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    }
+    for (; len > 0; data++, len--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(TR_CRC_SSE42)
+#if defined(__GNUC__)
+__attribute__((target("sse4.2")))
+#endif
+static uint32_t crc32cSse42(uint32_t crc, const unsigned char* data, size_t len) {
+#if defined(__x86_64__) || defined(_M_X64)
+    uint64_t crc64 = crc;
+    for (; len >= 8; data += 8, len -= 8) {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    for (; len >= 4; data += 4, len -= 4) {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        crc = _mm_crc32_u32(crc, value);
+    }
+    for (; len > 0; data++, len--) {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return crc;
+}
+
+static bool hasSse42() {
+#if defined(__GNUC__)
+    return __builtin_cpu_supports("sse4.2");
+#else
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] >> 20) & 1;
+#endif
+}
+#elif defined(__ARM_FEATURE_CRC32)
+static uint32_t crc32cArm(uint32_t crc, const unsigned char* data, size_t len) {
+    for (; len >= 8; data += 8, len -= 8) {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        crc = __crc32cd(crc, value);
+    }
+    for (; len > 0; data++, len--) {
+        crc = __crc32cb(crc, *data);
+    }
+    return crc;
+}
+#endif
+
+static CrcFunction getCrcFunction() {
+#if defined(TR_CRC_SSE42)
+    if (hasSse42()) {
+        return crc32cSse42;
+    }
+#elif defined(__ARM_FEATURE_CRC32)
+    return crc32cArm;
+#endif
+    return crc32cScalar;
+}
+
+uint32_t crc32cTr(uint32_t crc, const unsigned char* data, size_t len) {
+    // CPU is checked once
+    static const CrcFunction function = getCrcFunction();
+
+    return ~function(~crc, data, len);
+}
+
+bool isTrCrcAccelerated() {
+    return getCrcFunction() != crc32cScalar;
+}
+
+// Digests are hashed as 4B little endian
+static uint32_t crc32cDigest(uint32_t crc, uint32_t digest) {
+    unsigned char buffer[4];
+
+    buffer[0] = digest & 0xff;
+    buffer[1] = (digest >> 8) & 0xff;
+    buffer[2] = (digest >> 16) & 0xff;
+    buffer[3] = (digest >> 24) & 0xff;
+    return crc32cTr(crc, buffer, sizeof(buffer));
+}
+
+void TrImageDigest::addRegion(unsigned int addr, unsigned int end) {
+    if ((addr % TR_DIFF_BLOCK_LEN != 0) || (end % TR_DIFF_BLOCK_LEN != 0) || (addr >= end)) {
+        TR_THROW_EXCEPTION(TrException, "Region of image digest must be aligned to blocks!");
+    }
+    regions.push_back(TrRegionDigest(addr, end));
+}
+
+void TrImageDigest::compute(const TrDiffImage& img) {
+    std::vector<TrRegionDigest>::iterator itr;
+    size_t count = img.getBlockCount();
+    size_t total;
+    // Blocks beyond the end of the image are erased
+    const unsigned char* empty = img.getBlock(count);
+
+    erased = crc32cTr(0, empty, TR_DIFF_BLOCK_LEN);
+
+    // Trailing erased blocks are left out
+    while ((count > 0) && (std::memcmp(img.getBlock(count - 1), empty, TR_DIFF_BLOCK_LEN) == 0)) {
+        count--;
+    }
+    total = count;
+
+    for (itr = regions.begin(); itr != regions.end(); itr++) {
+        (*itr).digest = 0;
+        total = std::max(total, static_cast<size_t>((*itr).end / TR_DIFF_BLOCK_LEN));
+    }
+
+    blocks.resize(count);
+    image = 0;
+
+    for (size_t block = 0; block < total; block++) {
+        unsigned int addr = block * TR_DIFF_BLOCK_LEN;
+        uint32_t digest = erased;
+
+        if (block < count) {
+            digest = crc32cTr(0, img.getBlock(block), TR_DIFF_BLOCK_LEN);
+            blocks[block] = digest;
+            image = crc32cDigest(image, digest);
+        }
+
+        for (itr = regions.begin(); itr != regions.end(); itr++) {
+            if ((addr >= (*itr).addr) && (addr < (*itr).end)) {
+                (*itr).digest = crc32cDigest((*itr).digest, digest);
+            }
+        }
+    }
+}
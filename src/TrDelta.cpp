@@ -0,0 +1,243 @@
+/*
+ * Delta update package between two firmware versions.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <TrException.h>
+#include <TrHash.h>
+#include <TrDelta.h>
+#include "binary_operations.h"
+
+static const char DELTA_MAGIC[4]         = {'T', 'R', 'D', 'L'};
+static const unsigned char DELTA_VERSION = 2;
+static const size_t DELTA_HEADER_LEN     = 16;
+static const size_t SECTION_HEADER_LEN   = 24;
+// Address and pre-image hash of changed block
+static const size_t BLOCK_HEADER_LEN     = 12;
+static const size_t IQRF_HEADER_LEN      = 8;
+static const size_t OS_RECORD_LEN        = 6;
+static const size_t DELTA_HASH_LEN       = 8;
+static const unsigned char DELTA_IQRF    = 0x01;
+
+void TrDelta::addImages(const TrDiffImage& from, const TrDiffImage& to) {
+    std::vector<TrDiffBlock> diffs;
+    std::vector<TrDiffBlock>::const_iterator itr;
+    std::vector<size_t> dirty;
+    std::vector<size_t> changed;
+    std::vector<size_t> pre;
+    TrDeltaSection section(to.getMemory());
+    TrHash postHash;
+
+    if ((to.getMemory() != TrMemory::FLASH) && (to.getMemory() != TrMemory::EXTERNAL_EEPROM)) {
+        TR_THROW_EXCEPTION(TrException, "Delta can be built only for flash and external eeprom!");
+    }
+
+    diffTrImages(from, to, diffs);
+    if (diffs.empty()) {
+        return;
+    }
+
+    for (size_t word = 0; word < (from.getBlockCount() + 63) / 64; word++) {
+        uint64_t bits = from.getDirtyWord(word);
+        for (size_t bit = 0; bits != 0; bit++, bits >>= 1) {
+            if (bits & 1) {
+                dirty.push_back(word * 64 + bit);
+            }
+        }
+    }
+
+    // Old content of every changed block is hashed, partially applied delta
+    // is recognized block by block
+    for (itr = diffs.begin(); itr != diffs.end(); itr++) {
+        TrHash preHash;
+        changed.push_back((*itr).addr / TR_DIFF_BLOCK_LEN);
+        preHash.update(from.getBlock(changed.back()), TR_DIFF_BLOCK_LEN);
+        section.blocks.push_back(TrDeltaBlock((*itr).addr, preHash.digest(), 
+                                              std::basic_string<unsigned char>(to.getBlock(changed.back()), TR_DIFF_BLOCK_LEN)));
+    }
+
+    std::set_union(dirty.begin(), dirty.end(), changed.begin(), changed.end(), std::back_inserter(pre));
+
+    // Blocks which did not change are the same in both images
+    for (size_t i = 0; i < pre.size(); i++) {
+        postHash.update(to.getBlock(pre[i]), TR_DIFF_BLOCK_LEN);
+
+        if ((i > 0) && (pre[i] == pre[i - 1] + 1)) {
+            section.runs.back().second++;
+        } else {
+            section.runs.push_back(std::make_pair(pre[i] * TR_DIFF_BLOCK_LEN, 1));
+        }
+    }
+
+    section.postHash = postHash.digest();
+    sections.push_back(section);
+}
+
+void TrDelta::addIqrf(IqrfFmtParser& from, IqrfFmtParser& to) {
+    if ((std::distance(from.begin(), from.end()) == std::distance(to.begin(), to.end())) &&
+        std::equal(from.begin(), from.end(), to.begin())) {
+        return;
+    }
+
+    iqrf = true;
+    prgHeader = to.getPrgHeader();
+    records.assign(to.begin(), to.end());
+}
+
+void TrDelta::save(std::string name) const {
+    std::vector<TrDeltaSection>::const_iterator sitr;
+    std::basic_string<unsigned char> content(DELTA_HEADER_LEN, 0);
+    TrHash hash;
+
+    std::copy_n(DELTA_MAGIC, 4, content.begin());
+    content[4] = DELTA_VERSION;
+    content[5] = iqrf ? DELTA_IQRF : 0;
+    putValue(&content[8], sections.size(), 4);
+
+    for (sitr = sections.begin(); sitr != sections.end(); sitr++) {
+        unsigned char header[SECTION_HEADER_LEN] = {0};
+        header[0] = static_cast<unsigned char>((*sitr).memory);
+        putValue(header + 4, (*sitr).runs.size(), 4);
+        putValue(header + 8, (*sitr).blocks.size(), 4);
+        putValue(header + 16, (*sitr).postHash, 8);
+        content.append(header, SECTION_HEADER_LEN);
+
+        for (size_t i = 0; i < (*sitr).runs.size(); i++) {
+            appendValue(content, (*sitr).runs[i].first, 4);
+            appendValue(content, (*sitr).runs[i].second, 4);
+        }
+        for (size_t i = 0; i < (*sitr).blocks.size(); i++) {
+            appendValue(content, (*sitr).blocks[i].addr, 4);
+            appendValue(content, (*sitr).blocks[i].preHash, 8);
+            content.append((*sitr).blocks[i].data);
+        }
+    }
+
+    if (iqrf) {
+        const std::map<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>>& os = prgHeader.getSupportedOs();
+        std::map<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>>::const_iterator oitr;
+        unsigned char header[IQRF_HEADER_LEN] = {0};
+
+        header[0] = static_cast<unsigned char>(prgHeader.getMcu());
+        header[1] = static_cast<unsigned char>(prgHeader.getSerie());
+        putValue(header + 2, os.size(), 2);
+        putValue(header + 4, records.size(), 4);
+        content.append(header, IQRF_HEADER_LEN);
+
+        for (oitr = os.begin(); oitr != os.end(); oitr++) {
+            appendValue(content, (*oitr).first, 2);
+            appendValue(content, (*oitr).second.first, 2);
+            appendValue(content, (*oitr).second.second, 2);
+        }
+        for (size_t i = 0; i < records.size(); i++) {
+            content += static_cast<unsigned char>(records[i].length());
+            content.append(records[i]);
+        }
+    }
+
+    // Whole package is hashed, transfers to gateways can damage it
+    hash.update(content);
+    appendValue(content, hash.digest(), DELTA_HASH_LEN);
+
+    std::ofstream outfile(name, std::ios::binary | std::ios::trunc);
+    if (!outfile.write(reinterpret_cast<const char*>(content.data()), content.length()) || !outfile.flush()) {
+        TR_THROW_EXCEPTION(TrException, "Can not write delta " + name + "!");
+    }
+}
+
+void TrDelta::load(std::string name) {
+    std::ifstream infile(name, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+    const unsigned char* buffer = reinterpret_cast<const unsigned char*>(content.data());
+    size_t pos = DELTA_HEADER_LEN;
+    size_t end;
+    size_t count;
+    TrHash hash;
+
+    if ((content.length() < DELTA_HEADER_LEN + DELTA_HASH_LEN) || !std::equal(DELTA_MAGIC, DELTA_MAGIC + 4, content.begin())) {
+        TR_THROW_EXCEPTION(TrException, "File " + name + " is not a TR delta!");
+    }
+
+    if (buffer[4] != DELTA_VERSION) {
+        TR_THROW_EXCEPTION(TrException, "Unsupported version " + std::to_string(buffer[4]) + " of delta " + name + "!");
+    }
+
+    end = content.length() - DELTA_HASH_LEN;
+    hash.update(buffer, end);
+    if (hash.digest() != getValue(buffer + end, DELTA_HASH_LEN)) {
+        TR_THROW_EXCEPTION(TrException, "Hash of delta " + name + " does not match its content!");
+    }
+
+    sections.clear();
+    records.clear();
+    iqrf = (buffer[5] & DELTA_IQRF) != 0;
+    count = getValue(buffer + 8, 4);
+
+    for (size_t i = 0; i < count; i++) {
+        size_t runs;
+        size_t blocks;
+
+        if (pos + SECTION_HEADER_LEN > end) {
+            TR_THROW_EXCEPTION(TrException, "Delta " + name + " is truncated!");
+        }
+
+        TrDeltaSection section(static_cast<TrMemory>(buffer[pos]));
+        runs = getValue(buffer + pos + 4, 4);
+        blocks = getValue(buffer + pos + 8, 4);
+        section.postHash = getValue(buffer + pos + 16, 8);
+        pos += SECTION_HEADER_LEN;
+
+        if (pos + runs * 8 + blocks * (BLOCK_HEADER_LEN + TR_DIFF_BLOCK_LEN) > end) {
+            TR_THROW_EXCEPTION(TrException, "Delta " + name + " is truncated!");
+        }
+
+        for (size_t j = 0; j < runs; j++, pos += 8) {
+            section.runs.push_back(std::make_pair(getValue(buffer + pos, 4), getValue(buffer + pos + 4, 4)));
+        }
+        for (size_t j = 0; j < blocks; j++, pos += BLOCK_HEADER_LEN + TR_DIFF_BLOCK_LEN) {
+            section.blocks.push_back(TrDeltaBlock(getValue(buffer + pos, 4), getValue(buffer + pos + 4, 8), 
+                                                  std::basic_string<unsigned char>(buffer + pos + BLOCK_HEADER_LEN, TR_DIFF_BLOCK_LEN)));
+        }
+
+        sections.push_back(section);
+    }
+
+    if (iqrf) {
+        std::map<TrOsVersion, std::pair<TrOsBuild, TrOsBuild>> os;
+        size_t versions;
+
+        if (pos + IQRF_HEADER_LEN > end) {
+            TR_THROW_EXCEPTION(TrException, "Delta " + name + " is truncated!");
+        }
+
+        TrMcu mcu = static_cast<TrMcu>(buffer[pos]);
+        TrSerie serie = static_cast<TrSerie>(buffer[pos + 1]);
+        versions = getValue(buffer + pos + 2, 2);
+        count = getValue(buffer + pos + 4, 4);
+        pos += IQRF_HEADER_LEN;
+
+        if (pos + versions * OS_RECORD_LEN > end) {
+            TR_THROW_EXCEPTION(TrException, "Delta " + name + " is truncated!");
+        }
+        for (size_t i = 0; i < versions; i++, pos += OS_RECORD_LEN) {
+            os[getValue(buffer + pos, 2)] = std::make_pair(getValue(buffer + pos + 2, 2), getValue(buffer + pos + 4, 2));
+        }
+        prgHeader = IqrfPrgHeader(mcu, serie, os);
+
+        for (size_t i = 0; i < count; i++) {
+            if ((pos >= end) || (pos + 1 + buffer[pos] > end)) {
+                TR_THROW_EXCEPTION(TrException, "Delta " + name + " is truncated!");
+            }
+            records.push_back(std::basic_string<unsigned char>(buffer + pos + 1, buffer[pos]));
+            pos += 1 + buffer[pos];
+        }
+    }
+}
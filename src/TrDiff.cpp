@@ -0,0 +1,162 @@
+/*
+ * Block by block comparison of TR memory images.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <TrException.h>
+#include <TrDiff.h>
+#include <TrFill.h>
+
+static TrTarget getDiffTarget(TrMemory memory) {
+    switch(memory) {
+        case TrMemory::FLASH:
+            return TrTarget::FLASH;
+        case TrMemory::INTERNAL_EEPROM:
+            return TrTarget::INTERNAL_EEPROM;
+        case TrMemory::EXTERNAL_EEPROM:
+            return TrTarget::EXTERNAL_EEPROM;
+        default:
+            TR_THROW_EXCEPTION(TrException, "Invalid TR memory type for image!");
+            break;
+    }
+}
+
+static unsigned int getLowestBit(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    unsigned int bit = 0;
+    while (((word >> bit) & 1) == 0) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+TrDiffImage::TrDiffImage(TrMemory m) : memory(m) {
+    uint16_t fill = getTrFillPattern(memory);
+
+    for (size_t i = 0; i < TR_DIFF_BLOCK_LEN; i++) {
+        erased += (i % 2) ? (fill >> 8) : (fill & 0xff);
+    }
+}
+
+void TrDiffImage::set(unsigned int addr, const unsigned char* bytes, size_t len) {
+    uint16_t fill = getTrFillPattern(memory);
+    size_t end = addr + len;
+
+    if (len == 0) {
+        return;
+    }
+
+    while (data.length() < end) {
+        data += erased;
+    }
+    dirty.resize((getBlockCount() + 63) / 64, 0);
+
+    std::memcpy(&data[addr], bytes, len);
+
+    // Erased blocks stay clean, a block once dirty stays dirty
+    for (size_t block = addr / TR_DIFF_BLOCK_LEN; block <= (end - 1) / TR_DIFF_BLOCK_LEN; block++) {
+        if (!isDirty(block) && !isTrFillBlock(data.data() + block * TR_DIFF_BLOCK_LEN, TR_DIFF_BLOCK_LEN, fill)) {
+            dirty[block / 64] |= static_cast<uint64_t>(1) << (block % 64);
+        }
+    }
+}
+
+void TrDiffImage::addHex(HexFmtParser& parser) {
+    HexFmtParser::iterator itr;
+
+    for (itr = parser.begin(); itr != parser.end(); itr++) {
+        set((*itr).addr, (*itr).data);
+    }
+}
+
+void TrDiffImage::addSnapshot(const TrSnapshot& snapshot) {
+    TrSnapshot::const_iterator itr;
+    TrTarget target = getDiffTarget(memory);
+    // Snapshot addresses flash in 16b words
+    unsigned int scale = (memory == TrMemory::FLASH) ? 2 : 1;
+
+    for (itr = snapshot.begin(); itr != snapshot.end(); itr++) {
+        if ((*itr).target != target) {
+            continue;
+        }
+        for (size_t i = 0; i < (*itr).getBlockCount(); i++) {
+            set(((*itr).addr + i * (*itr).step) * scale, (*itr).data.data() + i * (*itr).blockLen, (*itr).blockLen);
+        }
+    }
+}
+
+const unsigned char* TrDiffImage::getBlock(size_t block) const {
+    if (block >= getBlockCount()) {
+        return erased.data();
+    }
+    return data.data() + block * TR_DIFF_BLOCK_LEN;
+}
+
+uint32_t diffTrBlock(const unsigned char* a, const unsigned char* b) {
+#if defined(__AVX2__)
+    // Compare whole block at once
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    return ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+#elif defined(__SSE2__)
+    // Compare 16B at once
+    uint32_t equal = 0;
+    for (size_t i = 0; i < TR_DIFF_BLOCK_LEN; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        equal |= static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) << i;
+    }
+    return ~equal;
+#else
+    // Compare 8B at once, bytes are checked only in differing words
+    uint32_t mask = 0;
+    for (size_t i = 0; i < TR_DIFF_BLOCK_LEN; i += 8) {
+        uint64_t x;
+        uint64_t y;
+        std::memcpy(&x, a + i, sizeof(x));
+        std::memcpy(&y, b + i, sizeof(y));
+        if (x != y) {
+            for (size_t j = i; j < i + 8; j++) {
+                mask |= static_cast<uint32_t>(a[j] != b[j]) << j;
+            }
+        }
+    }
+    return mask;
+#endif
+}
+
+void diffTrImages(const TrDiffImage& a, const TrDiffImage& b, std::vector<TrDiffBlock>& diffs) {
+    size_t blocks = std::max(a.getBlockCount(), b.getBlockCount());
+
+    if (a.getMemory() != b.getMemory()) {
+        TR_THROW_EXCEPTION(TrException, "Images of different TR memories can not be compared!");
+    }
+
+    diffs.clear();
+
+    // Only blocks dirty in any of the images can differ
+    for (size_t word = 0; word < (blocks + 63) / 64; word++) {
+        uint64_t dirty = a.getDirtyWord(word) | b.getDirtyWord(word);
+
+        while (dirty != 0) {
+            size_t block = word * 64 + getLowestBit(dirty);
+            uint32_t mask = diffTrBlock(a.getBlock(block), b.getBlock(block));
+
+            if (mask != 0) {
+                diffs.push_back(TrDiffBlock(block * TR_DIFF_BLOCK_LEN, mask));
+            }
+            dirty &= dirty - 1;
+        }
+    }
+}
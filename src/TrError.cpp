@@ -0,0 +1,85 @@
+/*
+ * Error codes of validation without exceptions.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <string>
+
+#include <TrException.h>
+#include <TrError.h>
+
+static const char* CHANNEL_MESSAGES[] = {
+    "Invalid main RF channel A of the optional subordinate network for configured RFBAND!",
+    "Invalid main RF channel B of the optional subordinate network for configured RFBAND!",
+    "Invalid main RF channel A of the main network for configured RFBAND!",
+    "Invalid main RF channel B of the main network for configured RFBAND!"
+};
+
+static std::string getShortMemoryName(TrMemory memory) {
+    switch(memory) {
+        case TrMemory::FLASH:
+            return "flash";
+        case TrMemory::INTERNAL_EEPROM:
+            return "internal eeprom";
+        case TrMemory::EXTERNAL_EEPROM:
+            return "external eeprom";
+        default:
+            return "unknown";
+    }
+}
+
+std::string getTrMemoryName(TrMemory memory) {
+    return getShortMemoryName(memory) + " memory";
+}
+
+std::string TrError::getMessage() const {
+    std::string len;
+
+    switch(code) {
+        case TrErrorCode::OK:
+            return "No error.";
+        case TrErrorCode::OUT_OF_RANGE:
+            if (memory == TrMemory::FLASH) {
+                return "Address in flash memory is outside application or extended flash memory!";
+            }
+            return "Address in " + getTrMemoryName(memory) + " is outside of addressable range!";
+        case TrErrorCode::MISALIGNED:
+            return "Address in " + getTrMemoryName(memory) + " should be modulo " + std::to_string(arg0) + "!";
+        case TrErrorCode::END_OUT_OF_RANGE:
+            return "End of write is out of the addressable range of the " + getShortMemoryName(memory) + "!";
+        case TrErrorCode::INVALID_LENGTH:
+            len = std::to_string(arg1);
+            if (arg0 != arg1) {
+                len = std::to_string(arg0) + "-" + len;
+            }
+            if (direction == TrDirection::UPLOAD) {
+                return "Data to be programmed into the " + getTrMemoryName(memory) + " must be " + len + "B long!";
+            }
+            return "Data from " + getTrMemoryName(memory) + " must be " + len + "B long!";
+        case TrErrorCode::INVALID_CFG_LENGTH:
+            return "Invalid length of the TR HWP configuration data!";
+        case TrErrorCode::INVALID_CFG_CHKSUM:
+            return "Invalid TR HWP configuration checksum!";
+        case TrErrorCode::INVALID_SPECIAL_LENGTH:
+            return "Data to be programmed by the special upload must be 18B long!";
+        case TrErrorCode::INVALID_RFBAND:
+            return "Invalid RF band received from TR!";
+        case TrErrorCode::INVALID_CHANNEL:
+            if (arg0 < sizeof(CHANNEL_MESSAGES) / sizeof(CHANNEL_MESSAGES[0])) {
+                return CHANNEL_MESSAGES[arg0];
+            }
+            return "Invalid RF channel for configured RFBAND!";
+        case TrErrorCode::UNSUPPORTED_TR:
+            return "TR type is not supported by the IQRF plugin!";
+        case TrErrorCode::UNSUPPORTED_OS:
+            return "OS version or OS build of the TR is not supported by the IQRF plugin!";
+    }
+    return "Unknown error!";
+}
+
+// Same description as built by TR_THROW_EXCEPTION at the error location
+void TrError::raise() const {
+    std::string descr = std::string(file) + " " + std::to_string(line) + getMessage();
+    throw TrException(descr.c_str());
+}
@@ -0,0 +1,57 @@
+/*
+ * Detection of erased blocks of TR memory.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <TrFill.h>
+
+static const uint16_t FLASH_FILL  = 0x3fff;
+static const uint16_t EEPROM_FILL = 0xffff;
+
+uint16_t getTrFillPattern(TrMemory memory) {
+    return (memory == TrMemory::FLASH) ? FLASH_FILL : EEPROM_FILL;
+}
+
+bool isTrFillBlock(const unsigned char* data, size_t len, uint16_t fill) {
+    unsigned char pattern[16];
+    size_t i = 0;
+
+    for (size_t j = 0; j < sizeof(pattern); j += 2) {
+        pattern[j] = fill & 0xff;
+        pattern[j + 1] = fill >> 8;
+    }
+
+#if defined(__SSE2__)
+    // Compare 16B at once
+    __m128i expected = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, expected)) != 0xffff) {
+            return false;
+        }
+    }
+#endif
+
+    // Compare 8B at once, differences are collected to leave the loop branch free
+    uint64_t expected64;
+    uint64_t diff = 0;
+    std::memcpy(&expected64, pattern, sizeof(expected64));
+    for (; i + 8 <= len; i += 8) {
+        uint64_t block;
+        std::memcpy(&block, data + i, sizeof(block));
+        diff |= block ^ expected64;
+    }
+
+    for (; i < len; i++) {
+        diff |= data[i] ^ pattern[i % 2];
+    }
+
+    return diff == 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Gang programming of identical TRs in lock-step.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+
+#include <TrException.h>
+#include <TrGang.h>
+
+/*
+ * Threads wait for each other after every command. Thread of a failed TR
+ * leaves the barrier and is not waited for any more.
+ */
+class TrGangBarrier {
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    size_t count;
+    size_t waiting;
+    uint64_t generation;
+
+    void release() {
+        waiting = 0;
+        generation++;
+        released.notify_all();
+    }
+public:
+    TrGangBarrier(size_t n) : count(n), waiting(0), generation(0) {}
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t current = generation;
+        if (++waiting == count) {
+            release();
+            return;
+        }
+        released.wait(lock, [this, current]{ return generation != current; });
+    }
+
+    void leave() {
+        std::lock_guard<std::mutex> lock(mutex);
+        count--;
+        if ((waiting > 0) && (waiting == count)) {
+            release();
+        }
+    }
+};
+
+size_t TrGang::addDevice(TrIfc* ifc) {
+    units.push_back(Unit(ifc));
+    return units.size() - 1;
+}
+
+void TrGang::fail(Unit& unit, const std::string& error) {
+    unit.error = error.empty() ? "Unknown error!" : error;
+    try {
+        unit.ifc->terminateProgrammingMode();
+    } catch (...) {
+        // Device has already failed, keep the first error
+    }
+}
+
+void TrGang::run(Unit& unit, const TrCommandStream& stream, TrGangBarrier& barrier) {
+    TrCommandStream::const_iterator itr;
+
+    try {
+        unit.ifc->checkStream(stream);
+        barrier.wait();
+
+        for (itr = stream.begin(); itr != stream.end(); itr++) {
+            unit.ifc->executeCommand(*itr, stream.getName());
+            barrier.wait();
+        }
+    } catch (std::exception& e) {
+        fail(unit, e.what());
+        barrier.leave();
+    } catch (...) {
+        // Thread must leave the barrier whatever is thrown, others would wait forever
+        fail(unit, "Unknown error!");
+        barrier.leave();
+    }
+}
+
+bool TrGang::executeStream(const TrCommandStream& stream) {
+    std::vector<std::thread> threads;
+    TrGangBarrier barrier(units.size());
+    std::vector<Unit>::iterator itr;
+
+    for (itr = units.begin(); itr != units.end(); itr++) {
+        (*itr).error.clear();
+    }
+
+    // Messages of the stream are built once and shared by all threads, they are only read
+    for (itr = units.begin(); itr != units.end(); itr++) {
+        threads.push_back(std::thread(&TrGang::run, this, std::ref(*itr), std::cref(stream), std::ref(barrier)));
+    }
+
+    for (std::vector<std::thread>::iterator thread = threads.begin(); thread != threads.end(); thread++) {
+        (*thread).join();
+    }
+
+    return std::none_of(units.begin(), units.end(), [](const Unit& u){return !u.error.empty();});
+}
+
+bool TrGang::uploadJob(TrJob& job) {
+    TrCommandStream stream;
+    std::vector<Unit>::iterator itr;
+
+    for (itr = units.begin(); itr != units.end(); itr++) {
+        try {
+            // Module info selects memory map of the TR
+            (*itr).ifc->getModuleInfo();
+            break;
+        } catch (std::exception& e) {
+            fail(*itr, e.what());
+        } catch (...) {
+            fail(*itr, "Unknown error!");
+        }
+    }
+
+    if (itr == units.end()) {
+        return false;
+    }
+
+    // Invalid job is not a failure of the devices
+    stream.compile(job, (*itr).ifc->getMemoryMap());
+
+    return executeStream(stream);
+}
@@ -0,0 +1,35 @@
+/*
+ * Hashing of TR memory images.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <TrHash.h>
+
+static const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+static const uint64_t FNV_PRIME  = 0x00000100000001b3ULL;
+
+TrHash::TrHash() : state(FNV_OFFSET) {
+}
+
+void TrHash::update(const unsigned char* data, size_t len) {
+    uint64_t h = state;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= FNV_PRIME;
+    }
+
+    state = h;
+}
+
+// Values are hashed as 4B little endian
+void TrHash::update(unsigned int value) {
+    unsigned char buffer[4];
+
+    buffer[0] = value & 0xff;
+    buffer[1] = (value >> 8) & 0xff;
+    buffer[2] = (value >> 16) & 0xff;
+    buffer[3] = (value >> 24) & 0xff;
+    update(buffer, sizeof(buffer));
+}
@@ -9,12 +9,33 @@
 #include <HexFmtParser.h>
 #include <IqrfFmtParser.h>
 #include <TrconfFmtParser.h>
+#include <TrCheckpoint.h>
+#include <TrHash.h>
+#include <TrMemoryMap.h>
+#include <TrJob.h>
+#include <TrCommandStream.h>
+#include <TrVerify.h>
+#include <TrSnapshot.h>
+#include <TrFill.h>
+#include <TrRingBuffer.h>
+#include <TrBlockCache.h>
+#include <TrWriteBack.h>
+#include <TrError.h>
+#include <TrImage.h>
+#include <TrLedger.h>
+#include <TrSnapshotStore.h>
+#include <TrDelta.h>
 #include <CdcInterface.h>
+#include "tr_protocol.h"
 
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <chrono>
+#include <thread>
+#include <exception>
+#include <limits>
 
 // Programming communication direction
 static const unsigned char UPLOAD                 = 0x80;
@@ -31,45 +52,235 @@ static const unsigned char INTERNAL_EEPROM_TARGET = 0x06;
 static const unsigned char EXTERNAL_EEPROM_TARGET = 0x07;
 static const unsigned char SPECIAL_TARGET         = 0x08;
 
-// Length, range and other constants
-static const size_t CFG_LEN                     = 32;
-static const unsigned char CFG_CHKSUM_INIT      = 0x5f;
-static const size_t ACCESS_PWD_LEN              = 16;
-static const size_t USER_KEY_LEN                = 16;
-static const size_t FLASH_UP_MODULO             = 16;
-static const size_t FLASH_DOWN_MODULO           = 32;
-static const unsigned int FLASH_APP_LOW         = 0x3a00;
-static const unsigned int FLASH_APP_HIGH        = 0x3fff; // TODO: Fix upper limit
-static const unsigned int FLASH_EXT_LOW         = 0x2c00; 
-static const unsigned int FLASH_EXT_HIGH        = 0x37bf; // TODO: Fix upper limits
-static const size_t FLASH_LEN                   = 32;
-static const unsigned int INT_EEPROM_UP_LOW     = 0x0000;
-static const unsigned int INT_EEPROM_UP_HIGH    = 0x00bf;
-static const size_t INT_EEPROM_UP_ADDR_LEN_MAX  = 0x00c0;
-static const size_t INT_EEPROM_UP_LEN_MIN       = 1;
-static const size_t INT_EEPROM_UP_LEN_MAX       = 32;
-static const unsigned int INT_EEPROM_DOWN_LOW   = 0x0000;
-static const unsigned int INT_EEPROM_DOWN_HIGH  = 0x00a0;
-static const size_t INT_EEPROM_DOWN_LEN         = 32;
-static const unsigned int EXT_EEPROM_LOW        = 0x0000;
-static const unsigned int EXT_EEPROM_UP_HIGH    = 0x3fe0;
-static const unsigned int EXT_EEPROM_DOWN_HIGH  = 0x7fe0;
-static const size_t EXT_EEPROM_MODULO           = 32;
-static const size_t EXT_EEPROM_LEN              = 32;
-static const size_t SPECIAL_LEN                 = 18;
+// Length, range and other constants, the shared ones are in tr_protocol.h
+static const size_t DOWNLOAD_RING_LEN           = 16;
+static const size_t EEPROM_BLOCK_LEN            = 32;
 
+// Address and length limits of flash and eeprom memories are in TrMemoryMap.h
+
+
+void TrIfc::setMemoryMap(TrMcu mcu, TrSerie serie) {
+    const TrMemoryMap* map = getTrMemoryMap(mcu, serie);
+    
+    if (map == nullptr) {
+        TR_THROW_EXCEPTION(TrException, "Memory map of TR with MCU " + std::to_string(static_cast<int>(mcu)) + " and serie " + std::to_string(static_cast<int>(serie)) + " is not known!");
+    }
+    
+    memoryMap = map;
+}
+
+TrError TrIfc::validateBlock(TrMemory memory, TrDirection direction, unsigned int addr, size_t len) const {
+    TrMemoryCheck result = memoryMap->check(memory, direction, addr, len);
+    const TrMemoryRegion* region;
+    
+    switch(result) {
+        case TrMemoryCheck::OK:
+            break;
+        case TrMemoryCheck::OUT_OF_RANGE:
+            return TrError(TrErrorCode::OUT_OF_RANGE, TR_ERROR_LOCATION, memory, direction);
+        case TrMemoryCheck::MISALIGNED:
+            region = memoryMap->find(memory, direction, addr);
+            return TrError(TrErrorCode::MISALIGNED, TR_ERROR_LOCATION, memory, direction, region->modulo);
+        case TrMemoryCheck::END_OUT_OF_RANGE:
+            return TrError(TrErrorCode::END_OUT_OF_RANGE, TR_ERROR_LOCATION, memory, direction);
+        case TrMemoryCheck::INVALID_LENGTH:
+            region = memoryMap->find(memory, direction, addr);
+            return TrError(TrErrorCode::INVALID_LENGTH, TR_ERROR_LOCATION, memory, direction, region->lenMin, region->lenMax);
+    }
+    return TrError();
+}
+
+void TrIfc::checkBlock(TrMemory memory, TrDirection direction, unsigned int addr, size_t len) {
+    TrError error = validateBlock(memory, direction, addr, len);
+    
+    if (!error.isOk()) {
+        error.raise();
+    }
+}
+
+void TrIfc::checkHex(TrMemory memory, HexFmtParser& parser) {
+    HexFmtParser::iterator itr;
+    
+    for (itr = parser.begin(); itr != parser.end(); itr++) {
+        // Address in Flash is in 16b words not in bytes
+        unsigned int addr = (memory == TrMemory::FLASH) ? (*itr).addr / 2 : (*itr).addr;
+        checkBlock(memory, TrDirection::UPLOAD, addr, (*itr).data.length());
+    }
+}
+
+static uint32_t elapsedUs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TrIfc::enableStats(bool enable) {
+    if (enable && !stats) {
+        stats.reset(new TrStats());
+    }
+    if (!enable) {
+        stats.reset();
+    }
+}
+
+TrStats TrIfc::getStats() const {
+    return stats ? *stats : TrStats();
+}
+
+void TrIfc::resetStats() {
+    if (stats) {
+        stats.reset(new TrStats());
+    }
+}
+
+void TrIfc::enableCache(bool enable) {
+    if (enable && !cache) {
+        cache.reset(new TrBlockCache());
+    }
+    if (!enable) {
+        cache.reset();
+    }
+}
+
+void TrIfc::invalidateCache() {
+    if (cache) {
+        cache->clear();
+    }
+}
+
+// Moves the cache away for the scope, transfers go to the TR
+class TrCacheBypass {
+private:
+    std::unique_ptr<TrBlockCache>& cache;
+    std::unique_ptr<TrBlockCache> saved;
+public:
+    TrCacheBypass(std::unique_ptr<TrBlockCache>& c) : cache(c), saved(std::move(c)) {}
+    ~TrCacheBypass() { cache = std::move(saved); }
+};
+
+static bool hasAddress(unsigned char target) {
+    return (target == FLASH_TARGET) || (target == INTERNAL_EEPROM_TARGET) || (target == EXTERNAL_EEPROM_TARGET);
+}
+
+// Byte address of the block in the message, flash is addressed in 16b words
+static unsigned int getCacheAddress(unsigned char target, const TrMessage& msg) {
+    if (!hasAddress(target)) {
+        return 0;
+    }
+    unsigned int addr = msg[0] | (msg[1] << 8);
+    return (target == FLASH_TARGET) ? addr * 2 : addr;
+}
+
+// Message is copied once into the reused channel buffer, which allocates
+// only while it grows to the protocol maximum
+void TrIfc::sendUpload(unsigned char target, const TrMessage& msg) {
+    channelMsg.assign(msg.data(), msg.length());
+    
+    if (!stats) {
+        ifc->upload(target|UPLOAD, channelMsg);
+        return;
+    }
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ifc->upload(target|UPLOAD, channelMsg);
+    stats->recordUpload(target, msg.length(), elapsedUs(start));
+}
+
+void TrIfc::sendDownload(unsigned char target, const TrMessage& msg, 
+                         std::basic_string<unsigned char>& data) {
+    channelMsg.assign(msg.data(), msg.length());
+    
+    if (!stats) {
+        ifc->download(target|DOWNLOAD, channelMsg, data);
+        return;
+    }
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ifc->download(target|DOWNLOAD, channelMsg, data);
+    stats->recordDownload(target, data.length(), elapsedUs(start));
+}
+
+void TrIfc::channelUpload(unsigned char target, const TrMessage& msg) {
+    // Older buffered writes must not overwrite the upload later
+    if (writeBack && ((target == INTERNAL_EEPROM_TARGET) || (target == EXTERNAL_EEPROM_TARGET) || 
+        (target == SPECIAL_TARGET))) {
+        flush();
+    }
+    
+    if (!cache) {
+        sendUpload(target, msg);
+        return;
+    }
+    
+    try {
+        sendUpload(target, msg);
+    } catch (...) {
+        // Content of TR is not known after failed upload
+        cache->clear();
+        throw;
+    }
+    
+    if (hasAddress(target)) {
+        cache->update(static_cast<TrTarget>(target), getCacheAddress(target, msg), msg.data() + 2, msg.length() - 2);
+    } else if (target == SPECIAL_TARGET) {
+        // Special uploads program any memory of TR
+        cache->clear();
+    } else {
+        cache->invalidate(static_cast<TrTarget>(target));
+    }
+}
+
+void TrIfc::channelDownload(unsigned char target, const TrMessage& msg, 
+                            std::basic_string<unsigned char>& data) {
+    if (!cache) {
+        sendDownload(target, msg, data);
+        return;
+    }
+    
+    unsigned int addr = getCacheAddress(target, msg);
+    if (!cache->find(static_cast<TrTarget>(target), addr, data)) {
+        sendDownload(target, msg, data);
+        cache->store(static_cast<TrTarget>(target), addr, data);
+    }
+}
 
 void TrIfc::enterProgrammingMode() {
     if (!prgMode) {
+        if (listener) {
+            listener->onPhase(TrPhase::ENTER_PRG_MODE);
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
         ifc->enterProgrammingMode();
         prgMode = true;
+        if (stats) {
+            stats->recordEnterMode(elapsedUs(start));
+        }
     }
 }
 
 void TrIfc::terminateProgrammingMode() {
     if (prgMode) {
+        std::exception_ptr error;
+        
+        // Programming mode is terminated even if buffered writes fail
+        try {
+            flush();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        
+        if (listener) {
+            listener->onPhase(TrPhase::TERMINATE_PRG_MODE);
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
         ifc->terminateProgrammingMode();
         prgMode = false;
+        invalidateCache();
+        if (stats) {
+            stats->recordTerminateMode(elapsedUs(start));
+        }
+        
+        if (error) {
+            std::rethrow_exception(error);
+        }
     }
 }
 
@@ -79,271 +290,1212 @@ static unsigned char computeCfgChksum(const std::basic_string<unsigned char>& da
     for (int i = 1; i < data.length(); i++) {
         chksum ^= data[i];
     }
-    
-    return chksum;
+    
+    return chksum;
+}
+
+TrError TrIfc::validateCfg(const std::basic_string<unsigned char>& data) {
+    if (data.length() != CFG_LEN) {
+        return TrError(TrErrorCode::INVALID_CFG_LENGTH, TR_ERROR_LOCATION);
+    }
+    
+    if (computeCfgChksum(data) != data[0]) {
+        return TrError(TrErrorCode::INVALID_CFG_CHKSUM, TR_ERROR_LOCATION);
+    }
+    
+    return TrError();
+}
+
+TrError TrIfc::validateSpecial(const std::basic_string<unsigned char>& data) {
+    if (data.length() != SPECIAL_LEN) {
+        return TrError(TrErrorCode::INVALID_SPECIAL_LENGTH, TR_ERROR_LOCATION);
+    }
+    
+    return TrError();
+}
+
+static void checkCfg(const std::basic_string<unsigned char>& data) {
+    TrError error = TrIfc::validateCfg(data);
+    
+    if (!error.isOk()) {
+        error.raise();
+    }
+}
+
+static void checkSpecial(const std::basic_string<unsigned char>& data) {
+    TrError error = TrIfc::validateSpecial(data);
+    
+    if (!error.isOk()) {
+        error.raise();
+    }
+}
+
+void TrIfc::uploadCfg(const std::basic_string<unsigned char>& data) {
+    checkCfg(data);
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    channelUpload(CFG_TARGET, TrMessage(data));
+}
+
+void TrIfc::uploadRFPMG(unsigned char rfpmg) {
+    TrMessage data;
+    
+    data.append(rfpmg);
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    channelUpload(RFPMG_TARGET, data);
+}
+
+void TrIfc::uploadRFBAND(unsigned char rfband) {
+    TrMessage data;
+    
+    data.append(rfband);
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    channelUpload(RFBAND_TARGET, data);
+}
+
+void TrIfc::uploadAccessPwd(const std::basic_string<unsigned char>& data) {
+    if (data.length() != ACCESS_PWD_LEN) {
+        TR_THROW_EXCEPTION(TrException, "Invalid length of access password!");
+    }
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    channelUpload(ACCESS_PWD_TARGET, TrMessage(data));
+}
+
+void TrIfc::uploadUserKey(const std::basic_string<unsigned char>& data) {
+    if (data.length() != USER_KEY_LEN) {
+        TR_THROW_EXCEPTION(TrException, "Invalid length of user key!");
+    }
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    channelUpload(USER_KEY_TARGET, TrMessage(data));
+}
+
+// Block must be already checked against memory map
+void TrIfc::sendBlock(unsigned char target, unsigned int addr, const std::basic_string<unsigned char>& data) {
+    sendBlock(target, addr, data.data(), data.length());
+}
+
+void TrIfc::sendBlock(unsigned char target, unsigned int addr, const unsigned char* data, size_t len) {
+    TrMessage msg;
+    
+    msg.appendAddress(addr);
+    msg.append(data, len);
+    channelUpload(target, msg);
+}
+
+void TrIfc::uploadFlash(unsigned int addr, const std::basic_string<unsigned char>& data) {
+    // Address in Flash is in 16b words not in bytes
+    addr = addr / 2;
+    
+    checkBlock(TrMemory::FLASH, TrDirection::UPLOAD, addr, data.length());
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    sendBlock(FLASH_TARGET, addr, data);
+}
+
+void TrIfc::uploadInternalEeprom(unsigned int addr, const std::basic_string<unsigned char>& data) {
+    checkBlock(TrMemory::INTERNAL_EEPROM, TrDirection::UPLOAD, addr, data.length());
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    if (writeBack) {
+        writeBack->add(TrMemory::INTERNAL_EEPROM, addr, data);
+        return;
+    }
+    
+    sendBlock(INTERNAL_EEPROM_TARGET, addr, data);
+}
+
+void TrIfc::uploadExternalEeprom(unsigned int addr, const std::basic_string<unsigned char>& data) {
+    if (writeBack) {
+        // All touched blocks must be writable
+        for (unsigned int base = addr - addr % EEPROM_BLOCK_LEN; base < addr + data.length(); base += EEPROM_BLOCK_LEN) {
+            checkBlock(TrMemory::EXTERNAL_EEPROM, TrDirection::UPLOAD, base, EEPROM_BLOCK_LEN);
+        }
+        
+        if (!prgMode) {
+            TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+        }
+        
+        writeBack->add(TrMemory::EXTERNAL_EEPROM, addr, data);
+        return;
+    }
+    
+    checkBlock(TrMemory::EXTERNAL_EEPROM, TrDirection::UPLOAD, addr, data.length());
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    sendBlock(EXTERNAL_EEPROM_TARGET, addr, data);
+}
+
+void TrIfc::enableWriteBack(bool enable) {
+    if (enable && !writeBack) {
+        writeBack.reset(new TrWriteBack());
+    }
+    if (!enable && writeBack) {
+        flush();
+        writeBack.reset();
+    }
+}
+
+void TrIfc::flushInternalEeprom(const TrWriteBack& pending) {
+    const TrWriteBack::Runs& runs = pending.getRuns(TrMemory::INTERNAL_EEPROM);
+    TrWriteBack::Runs::const_iterator itr;
+    
+    // Runs are split into the longest allowed writes
+    for (itr = runs.begin(); itr != runs.end(); itr++) {
+        for (size_t offset = 0; offset < (*itr).second.length(); offset += EEPROM_BLOCK_LEN) {
+            unsigned int addr = (*itr).first + offset;
+            std::basic_string<unsigned char> data = (*itr).second.substr(offset, EEPROM_BLOCK_LEN);
+            checkBlock(TrMemory::INTERNAL_EEPROM, TrDirection::UPLOAD, addr, data.length());
+            sendBlock(INTERNAL_EEPROM_TARGET, addr, data);
+        }
+    }
+}
+
+void TrIfc::flushExternalEeprom(const TrWriteBack& pending) {
+    const TrWriteBack::Runs& runs = pending.getRuns(TrMemory::EXTERNAL_EEPROM);
+    TrWriteBack::Runs::const_iterator itr;
+    unsigned int next = 0;
+    
+    // Every touched block is written once, partially written blocks are
+    // completed by the content of the TR
+    for (itr = runs.begin(); itr != runs.end(); itr++) {
+        unsigned int first = (*itr).first - (*itr).first % EEPROM_BLOCK_LEN;
+        unsigned int end = (*itr).first + (*itr).second.length();
+        
+        for (unsigned int base = std::max(first, next); base < end; base += EEPROM_BLOCK_LEN) {
+            std::basic_string<unsigned char> block(EEPROM_BLOCK_LEN, 0);
+            
+            if (pending.overlay(TrMemory::EXTERNAL_EEPROM, base, block) < EEPROM_BLOCK_LEN) {
+                downloadExternalEeprom(base, block);
+                pending.overlay(TrMemory::EXTERNAL_EEPROM, base, block);
+            }
+            sendBlock(EXTERNAL_EEPROM_TARGET, base, block);
+            next = base + EEPROM_BLOCK_LEN;
+        }
+    }
+}
+
+void TrIfc::flush() {
+    // Uploads and downloads of the flush itself do not flush
+    if (!writeBack || writeBack->empty() || flushing) {
+        return;
+    }
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    // Buffer is kept until all writes succeed, rewriting already written
+    // blocks by the next flush is harmless
+    flushing = true;
+    try {
+        flushInternalEeprom(*writeBack);
+        flushExternalEeprom(*writeBack);
+    } catch (...) {
+        flushing = false;
+        throw;
+    }
+    flushing = false;
+    writeBack->clear();
+}
+
+void TrIfc::uploadSpecial(const std::basic_string<unsigned char>& data) {   
+    checkSpecial(data);
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    channelUpload(SPECIAL_TARGET, TrMessage(data));
+}
+
+
+static TrCheckpointTarget getCheckpointTarget(TrMemory memory) {
+    switch(memory) {
+        case TrMemory::FLASH:
+            return TrCheckpointTarget::FLASH;
+        case TrMemory::INTERNAL_EEPROM:
+            return TrCheckpointTarget::INTERNAL_EEPROM;
+        case TrMemory::EXTERNAL_EEPROM:
+            return TrCheckpointTarget::EXTERNAL_EEPROM;
+        default:
+            TR_THROW_EXCEPTION(TrException, "Invalid TR memory type for HEX file!");
+            break;
+    }
+}
+
+static uint64_t hashHex(TrMemory memory, HexFmtParser& parser) {
+    HexFmtParser::iterator itr;
+    TrHash hash;
+    
+    hash.update(static_cast<unsigned int>(memory));
+    for (itr = parser.begin(); itr != parser.end(); itr++) {
+        hash.update((*itr).addr);
+        hash.update((*itr).data);
+    }
+    
+    return hash.digest();
+}
+
+static uint64_t hashIqrf(IqrfFmtParser& parser) {
+    IqrfFmtParser::iterator itr;
+    TrHash hash;
+    
+    for (itr = parser.begin(); itr != parser.end(); itr++) {
+        hash.update(*itr);
+    }
+    
+    return hash.digest();
+}
+
+void TrIfc::readBack(TrMemory memory, unsigned int addr, size_t len, std::basic_string<unsigned char>& data) {
+    ReadBackBlock block;
+    
+    readBack(memory, addr, len, data, block);
+}
+
+void TrIfc::readBack(TrMemory memory, unsigned int addr, size_t len, std::basic_string<unsigned char>& data, 
+                     ReadBackBlock& block) {
+    // Address in Flash is in 16b words not in bytes
+    unsigned int word = (memory == TrMemory::FLASH) ? addr / 2 : addr;
+    unsigned int base = 0;
+    size_t offset;
+    
+    if (memoryMap->findDownload(memory, word, base) == nullptr) {
+        checkBlock(memory, TrDirection::DOWNLOAD, word, 0);
+    }
+    
+    if ((block.memory != memory) || (block.base != base)) {
+        block.memory = TrMemory::ERROR;
+        switch(memory) {
+            case TrMemory::FLASH:
+                downloadFlash(base, block.data);
+                break;
+            case TrMemory::INTERNAL_EEPROM:
+                downloadInternalEeprom(base, block.data);
+                break;
+            case TrMemory::EXTERNAL_EEPROM:
+                downloadExternalEeprom(base, block.data);
+                break;
+            default:
+                TR_THROW_EXCEPTION(TrException, "Invalid TR memory type for read back!");
+                break;
+        }
+        block.memory = memory;
+        block.base = base;
+    }
+    
+    offset = (memory == TrMemory::FLASH) ? (addr / 2 - base) * 2 : addr - base;
+    
+    if (offset + len > block.data.length()) {
+        TR_THROW_EXCEPTION(TrException, "Can not read back " + std::to_string(len) + "B from address " + std::to_string(addr) + "!");
+    }
+    
+    data = block.data.substr(offset, len);
+}
+
+void TrIfc::readBack(const TrVerifyBlock& written, std::basic_string<unsigned char>& data, ReadBackBlock& block) {
+    switch(written.target) {
+        case TrTarget::CFG:
+            downloadCfg(data);
+            break;
+        case TrTarget::RFPMG:
+            data = std::basic_string<unsigned char>(1, downloadRFPMG());
+            break;
+        case TrTarget::FLASH:
+            readBack(TrMemory::FLASH, written.addr, written.data.length(), data, block);
+            break;
+        case TrTarget::INTERNAL_EEPROM:
+            readBack(TrMemory::INTERNAL_EEPROM, written.addr, written.data.length(), data, block);
+            break;
+        case TrTarget::EXTERNAL_EEPROM:
+            readBack(TrMemory::EXTERNAL_EEPROM, written.addr, written.data.length(), data, block);
+            break;
+        default:
+            TR_THROW_EXCEPTION(TrException, "Invalid TR target for verification!");
+            break;
+    }
+}
+
+static std::string getTargetName(TrTarget target) {
+    switch(target) {
+        case TrTarget::CFG:
+            return "configuration";
+        case TrTarget::RFPMG:
+            return "RFPMG";
+        case TrTarget::RFBAND:
+            return "RFBAND";
+        case TrTarget::FLASH:
+            return getTrMemoryName(TrMemory::FLASH);
+        case TrTarget::INTERNAL_EEPROM:
+            return getTrMemoryName(TrMemory::INTERNAL_EEPROM);
+        case TrTarget::EXTERNAL_EEPROM:
+            return getTrMemoryName(TrMemory::EXTERNAL_EEPROM);
+        default:
+            return "unknown target";
+    }
+}
+
+static std::vector<TrVerifyBlock> getCfgBlocks(const std::basic_string<unsigned char>& data, unsigned char rfpmg) {
+    std::vector<TrVerifyBlock> blocks;
+    
+    blocks.push_back(TrVerifyBlock(TrTarget::CFG, 0, data));
+    blocks.push_back(TrVerifyBlock(TrTarget::RFPMG, 0, std::basic_string<unsigned char>(1, rfpmg)));
+    return blocks;
+}
+
+void TrIfc::setVerify(TrVerifyMode mode, unsigned int percent) {
+    verifyMode = mode;
+    verifyPercent = percent;
+    verifyPending.clear();
+    mismatches.clear();
+}
+
+void TrIfc::verify() {
+    std::vector<TrVerifyBlock> blocks;
+    
+    blocks.swap(verifyPending);
+    verifyBlocks(blocks);
+}
+
+void TrIfc::verifyWritten(std::vector<TrVerifyBlock>& blocks) {
+    std::vector<TrVerifyBlock> sampled;
+    std::vector<TrVerifyBlock>::iterator itr;
+    
+    switch(verifyMode) {
+        case TrVerifyMode::NONE:
+            break;
+        case TrVerifyMode::FULL:
+            verifyBlocks(blocks);
+            break;
+        case TrVerifyMode::SAMPLED:
+            for (itr = blocks.begin(); itr != blocks.end(); itr++) {
+                if (isTrBlockSampled((*itr).target, (*itr).addr, verifyPercent)) {
+                    sampled.push_back(*itr);
+                }
+            }
+            verifyBlocks(sampled);
+            break;
+        case TrVerifyMode::DEFERRED:
+            verifyPending.insert(verifyPending.end(), blocks.begin(), blocks.end());
+            break;
+    }
+}
+
+void TrIfc::verifyBlocks(std::vector<TrVerifyBlock>& blocks) {
+    std::vector<TrVerifyBlock>::iterator itr;
+    ReadBackBlock block;
+    size_t found = 0;
+    TrProgressTracker progress(listener, TrPhase::VERIFY, blocks.size());
+    
+    // Cache holds uploaded data, read back must reach the TR
+    TrCacheBypass bypass(cache);
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    // Blocks in one downloaded block are read back by a single download
+    std::stable_sort(blocks.begin(), blocks.end(), [](const TrVerifyBlock& a, const TrVerifyBlock& b) {
+        return (a.target < b.target) || ((a.target == b.target) && (a.addr < b.addr));
+    });
+    
+    for (itr = blocks.begin(); itr != blocks.end(); itr++) {
+        std::basic_string<unsigned char> data;
+        
+        readBack(*itr, data, block);
+        
+        if (data != (*itr).data) {
+            mismatches.push_back(TrMismatch(*itr, data));
+            found++;
+        }
+        progress.advance((*itr).data.length());
+    }
+    
+    if (found > 0) {
+        const TrMismatch& first = mismatches[mismatches.size() - found];
+        TR_THROW_EXCEPTION(TrException, "Verification failed, " + std::to_string(found) + " blocks differ! First mismatch is at address " + std::to_string(first.addr) + " of " + getTargetName(first.target) + ".");
+    }
+}
+
+void TrIfc::uploadHex(TrMemory memory, HexFmtParser& parser, size_t first) {
+    HexFmtParser::iterator itr;
+    TrCheckpoint checkpoint(checkpointName);
+    TrCheckpointData state;
+    TrProgressTracker progress(listener, TrPhase::UPLOAD_HEX, std::distance(parser.begin(), parser.end()), first);
+    unsigned char target = static_cast<unsigned char>(getMemoryTarget(memory));
+    // Address in Flash is in 16b words not in bytes
+    unsigned int shift = (memory == TrMemory::FLASH) ? 1 : 0;
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    if (!checkpointName.empty()) {
+        state.target = getCheckpointTarget(memory);
+        state.hash = hashHex(memory, parser);
+        state.blocks = std::distance(parser.begin(), parser.end());
+        state.next = first;
+        checkpoint.save(state);
+    }
+    
+    // Whole image was checked by checkHex
+    for (itr = parser.begin() + first; itr != parser.end(); itr++) {
+        sendBlock(target, (*itr).addr >> shift, (*itr).data);
+        progress.advance((*itr).data.length());
+        
+        if (!checkpointName.empty()) {
+            state.next++;
+            checkpoint.save(state);
+        }
+    }
+    
+    if (!checkpointName.empty()) {
+        checkpoint.remove();
+    }
+    
+    if (verifyMode != TrVerifyMode::NONE) {
+        std::vector<TrVerifyBlock> blocks;
+        for (itr = parser.begin() + first; itr != parser.end(); itr++) {
+            blocks.push_back(TrVerifyBlock(static_cast<TrTarget>(target), (*itr).addr, (*itr).data));
+        }
+        verifyWritten(blocks);
+    }
+}
+
+void TrIfc::uploadHex(TrMemory memory, std::string name) {
+    HexFmtParser parser(memory, name);
+    
+    parser.setListener(listener);
+    parser.parse();
+    checkHex(memory, parser);
+    
+    uploadHex(memory, parser, 0);
+}
+
+void TrIfc::resumeHex(TrMemory memory, std::string name) {
+    HexFmtParser parser(memory, name);
+    TrCheckpointData state;
+    size_t first = 0;
+    
+    parser.setListener(listener);
+    parser.parse();
+    checkHex(memory, parser);
+    
+    if (!checkpointName.empty() && TrCheckpoint(checkpointName).load(state)) {
+        if ((state.target == getCheckpointTarget(memory)) && (state.hash == hashHex(memory, parser)) && 
+            (state.blocks == std::distance(parser.begin(), parser.end())) && (state.next > 0)) {
+            // Last acknowledged block must be on the device, otherwise the device
+            // was touched since the checkpoint and the upload starts from scratch
+            HexDataRecord& last = *(parser.begin() + state.next - 1);
+            std::basic_string<unsigned char> data;
+            TrCacheBypass bypass(cache);
+            readBack(memory, last.addr, last.data.length(), data);
+            if (data == last.data) {
+                first = state.next;
+            }
+        }
+    }
+    
+    uploadHex(memory, parser, first);
+}
+
+// Unknown MCU or serie is NONE, unknown is set to the description of the type
+static TrModuleInfo getTrModuleInfo(ModuleInfo* moduleInfo, std::string& unknown) {
+    TrModuleInfo info;
+    
+    unknown.clear();
+    info.serial = (moduleInfo->serialNumber[3] << 24) | (moduleInfo->serialNumber[2] << 16) | 
+                  (moduleInfo->serialNumber[1] << 8) | moduleInfo->serialNumber[0];
+    info.osVersion = moduleInfo->osVersion;
+    switch(moduleInfo->PICType & 0x7) {
+        case 4:
+            info.mcu = TrMcu::PIC16F1938;
+            break;
+        default:
+            info.mcu = TrMcu::NONE;
+            unknown = "Unknown type of MCU download from TR: " + std::to_string(moduleInfo->PICType & 0x7) + "!";
+            break;
+    }
+    
+    info.osBuild = (moduleInfo->osBuild[1] << 8) | moduleInfo->osBuild[0];
+    switch(moduleInfo->PICType >> 4) {
+        case 0:
+        case 1:
+        case 3:
+        case 8:
+        case 9:
+        case 10:
+            info.serie = TrSerie::DCTR_5xD;
+            break;
+        case 2:
+        case 11:
+            info.serie = TrSerie::DCTR_7xD;
+            break;
+        default:
+            info.serie = TrSerie::NONE;
+            if (unknown.empty()) {
+                unknown = "Unknown serie downloaded from TR: " + std::to_string(moduleInfo->PICType >> 4) + "!";
+            }
+            break;
+    }
+    
+    return info;
+}
+
+const TrModuleInfo& TrIfc::readModuleInfo() {
+    if (!moduleInfoValid) {
+        bool mode = prgMode;
+        const TrMemoryMap* map;
+        
+        // Module info can be read only outside of programming mode
+        terminateProgrammingMode();
+        moduleInfo = getTrModuleInfo(static_cast<ModuleInfo*>(ifc->getTRModuleInfo()), unknownType);
+        moduleInfoValid = true;
+        if (mode) {
+            enterProgrammingMode();
+        }
+        
+        // TR without memory map is programmed with the current one
+        map = getTrMemoryMap(moduleInfo.mcu, moduleInfo.serie);
+        if (map != nullptr) {
+            memoryMap = map;
+        }
+    }
+    
+    return moduleInfo;
+}
+
+const TrModuleInfo& TrIfc::getModuleInfo() {
+    readModuleInfo();
+    
+    if (!unknownType.empty()) {
+        TR_THROW_EXCEPTION(TrException, unknownType);
+    }
+    
+    return moduleInfo;
+}
+
+void TrIfc::invalidateModuleInfo() {
+    moduleInfoValid = false;
+}
+
+void TrIfc::checkIqrf(IqrfFmtParser& parser) {
+    TrModuleInfo info = getModuleInfo();
+    
+    if (!parser.validate(info).isOk()) {
+        TR_THROW_EXCEPTION(TrException, "IQRF file " + parser.getFileName() + " can not be upload to TR! TR is not in supported types specified in the IQRF file. This message is caused by incopatible type of TR, OS version or OS build.");
+    }
+}
+
+void TrIfc::checkIqrfData(IqrfFmtParser& parser) {
+    IqrfFmtParser::iterator itr;
+    
+    for (itr = parser.begin(); itr != parser.end(); itr++) {
+        checkSpecial(*itr);
+    }
+}
+
+// IQRF uploads are not journalled, see resumeIqrf
+void TrIfc::uploadIqrf(IqrfFmtParser& parser) {
+    IqrfFmtParser::iterator itr;
+    TrProgressTracker progress(listener, TrPhase::UPLOAD_IQRF, std::distance(parser.begin(), parser.end()));
+    
+    if (!prgMode) {
+        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    }
+    
+    // All records were checked by checkIqrfData
+    for (itr = parser.begin(); itr != parser.end(); itr++) {
+        channelUpload(SPECIAL_TARGET, TrMessage(*itr));
+        progress.advance((*itr).length());
+    }
+}
+
+void TrIfc::uploadIqrf(std::string name) {
+    IqrfFmtParser parser(name);
+    
+    parser.setListener(listener);
+    parser.parse();
+    checkIqrfData(parser);
+    // Module info is read before programming mode is entered
+    checkIqrf(parser);
+    
+    enterProgrammingMode();
+    uploadIqrf(parser);
+}
+
+// Special uploads can not be read back and the TR accepts the plugin only
+// as a whole sequence, so an interrupted IQRF upload restarts from its first
+// record. Nothing is journalled for it.
+void TrIfc::resumeIqrf(std::string name) {
+    uploadIqrf(name);
+}
+
+void TrIfc::uploadCfg(std::string name) {
+    unsigned char rfpmg;
+    TrconfFmtParser parser(name);
+    parser.parse();
+    
+    rfpmg = parser.getRFPMG();
+    
+    parser.checkChannels(downloadRFBAND());
+    
+    TrProgressTracker progress(listener, TrPhase::UPLOAD_CFG, 2);
+    uploadCfg(parser.getData());
+    progress.advance(CFG_LEN);
+    uploadRFPMG(rfpmg);
+    progress.advance(1);
+    
+    if (verifyMode != TrVerifyMode::NONE) {
+        std::vector<TrVerifyBlock> blocks = getCfgBlocks(parser.getData(), rfpmg);
+        verifyWritten(blocks);
+    }
+}
+
+static TrLedgerItem getLedgerItem(TrMemory memory) {
+    switch(memory) {
+        case TrMemory::FLASH:
+            return TrLedgerItem::FLASH;
+        case TrMemory::INTERNAL_EEPROM:
+            return TrLedgerItem::INTERNAL_EEPROM;
+        case TrMemory::EXTERNAL_EEPROM:
+            return TrLedgerItem::EXTERNAL_EEPROM;
+        default:
+            TR_THROW_EXCEPTION(TrException, "Invalid TR memory type for HEX file!");
+            break;
+    }
 }
 
-void TrIfc::uploadCfg(const std::basic_string<unsigned char>& data) {
-    if (data.length() != CFG_LEN) {
-        TR_THROW_EXCEPTION(TrException, "Invalid length of the TR HWP configuration data!");
+// Ledger entries of job parts in order of programming - CFG, RFPMG, HEX files, IQRF
+static std::vector<TrLedgerEntry> getLedgerEntries(TrJob& job) {
+    std::vector<TrLedgerEntry> parts;
+    TrJob::hex_iterator itr;
+    
+    if (job.getTrconf()) {
+        TrHash cfg;
+        TrHash rfpmg;
+        cfg.update(job.getTrconf()->getData());
+        rfpmg.update(job.getTrconf()->getRFPMG());
+        parts.push_back(TrLedgerEntry(TrLedgerItem::CFG, 0, 0, cfg.digest()));
+        parts.push_back(TrLedgerEntry(TrLedgerItem::RFPMG, 0, 0, rfpmg.digest()));
     }
-
     
-    if (computeCfgChksum(data) != data[0]) {
-        TR_THROW_EXCEPTION(TrException, "Invalid TR HWP configuration checksum!");
+    for (itr = job.hexBegin(); itr != job.hexEnd(); itr++) {
+        HexFmtParser::iterator block;
+        unsigned int addr = std::numeric_limits<unsigned int>::max();
+        unsigned int end = 0;
+        
+        for (block = (*itr).parser.begin(); block != (*itr).parser.end(); block++) {
+            addr = std::min(addr, (*block).addr);
+            end = std::max(end, static_cast<unsigned int>((*block).addr + (*block).data.length()));
+        }
+        parts.push_back(TrLedgerEntry(getLedgerItem((*itr).memory), std::min(addr, end), end, hashHex((*itr).memory, (*itr).parser)));
     }
     
-    if (!prgMode) {
-        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    if (job.getIqrf()) {
+        parts.push_back(TrLedgerEntry(TrLedgerItem::IQRF, 0, 0, hashIqrf(*job.getIqrf())));
     }
     
-    ifc->upload(CFG_TARGET|UPLOAD, data); 
+    return parts;
 }
 
-void TrIfc::uploadRFPMG(unsigned char rfpmg) {
-    std::basic_string<unsigned char> data;
-    
-    data += rfpmg;
+// Blocks spread evenly over the HEX file, the first and the last one included
+static std::vector<TrVerifyBlock> getSampleBlocks(TrMemory memory, HexFmtParser& parser, unsigned int count) {
+    std::vector<TrVerifyBlock> samples;
+    size_t blocks = std::distance(parser.begin(), parser.end());
+    TrTarget target = getMemoryTarget(memory);
+    
+    if (count > blocks) {
+        count = blocks;
+    }
     
-    if (!prgMode) {
-        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    for (size_t i = 0; i < count; i++) {
+        HexDataRecord& block = *(parser.begin() + ((count == 1) ? 0 : i * (blocks - 1) / (count - 1)));
+        samples.push_back(TrVerifyBlock(target, block.addr, block.data));
     }
     
-    ifc->upload(RFPMG_TARGET|UPLOAD, data);
+    return samples;
 }
 
-void TrIfc::uploadRFBAND(unsigned char rfband) {
-    std::basic_string<unsigned char> data;
+bool TrIfc::isPartCurrent(TrSerial serial, const std::vector<TrLedgerEntry>& parts, size_t part, 
+                          const std::vector<TrVerifyBlock>& samples) {
+    std::vector<TrVerifyBlock>::const_iterator itr;
+    ReadBackBlock block;
     
-    data += rfband;
+    if ((part >= parts.size()) || !ledger->isCurrent(serial, parts[part])) {
+        return false;
+    }
     
-    if (!prgMode) {
-        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    // Cache holds uploaded data, read back must reach the TR
+    TrCacheBypass bypass(cache);
+    
+    for (itr = samples.begin(); itr != samples.end(); itr++) {
+        std::basic_string<unsigned char> data;
+        
+        readBack(*itr, data, block);
+        if (data != (*itr).data) {
+            return false;
+        }
     }
     
-    ifc->upload(RFBAND_TARGET|UPLOAD, data);
+    return true;
 }
 
-void TrIfc::uploadAccessPwd(const std::basic_string<unsigned char>& data) {
-    if (data.length() != ACCESS_PWD_LEN) {
-        TR_THROW_EXCEPTION(TrException, "Invalid length of access password!");
+void TrIfc::recordPart(TrSerial serial, const std::vector<TrLedgerEntry>& parts, size_t part, 
+                       const std::vector<TrVerifyBlock>& samples, std::vector<TrLedgerEntry>& pending) {
+    if (part >= parts.size()) {
+        return;
     }
     
-    if (!prgMode) {
-        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    // Unverified part is never recorded as current
+    if (verifyMode == TrVerifyMode::NONE) {
+        std::vector<TrVerifyBlock> blocks(samples);
+        verifyBlocks(blocks);
     }
     
-    ifc->upload(ACCESS_PWD_TARGET|UPLOAD, data);
+    if (verifyMode == TrVerifyMode::DEFERRED) {
+        pending.push_back(parts[part]);
+    } else {
+        ledger->record(serial, parts[part]);
+    }
 }
 
-void TrIfc::uploadUserKey(const std::basic_string<unsigned char>& data) {
-    if (data.length() != USER_KEY_LEN) {
-        TR_THROW_EXCEPTION(TrException, "Invalid length of user key!");
+void TrIfc::checkJob(TrJob& job) {
+    TrJob::hex_iterator itr;
+    
+    if (!job.isParsed()) {
+        job.parse(listener);
     }
     
-    if (!prgMode) {
-        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    // Blocks are checked against memory map of the TR
+    readModuleInfo();
+    
+    if (job.getTrconf()) {
+        checkCfg(job.getTrconf()->getData());
+    }
+    
+    for (itr = job.hexBegin(); itr != job.hexEnd(); itr++) {
+        checkHex((*itr).memory, (*itr).parser);
     }
     
-    ifc->upload(USER_KEY_TARGET|UPLOAD, data);
+    if (job.getIqrf()) {
+        checkIqrfData(*job.getIqrf());
+        checkIqrf(*job.getIqrf());
+    }
 }
 
-static void insertAddress(std::basic_string<unsigned char> &msg, unsigned int addr) {
-	msg += addr & 0xff;
-    msg += (addr >> 8) &  0xff;
+void TrIfc::uploadJob(TrJob& job) {
+    TrJob::hex_iterator itr;
+    std::vector<TrLedgerEntry> parts;
+    std::vector<TrLedgerEntry> pending;
+    std::vector<TrLedgerEntry>::iterator entry;
+    TrSerial serial = 0;
+    size_t part = 0;
+    
+    // Nothing is written unless the whole job is valid
+    checkJob(job);
+    
+    if (ledger) {
+        serial = readModuleInfo().serial;
+        parts = getLedgerEntries(job);
+        
+        // TR known to be current is not touched at all
+        if ((ledgerSamples == 0) && std::all_of(parts.begin(), parts.end(), [this, serial](const TrLedgerEntry& e) {
+                return ledger->isCurrent(serial, e);
+            })) {
+            return;
+        }
+    }
+    
+    enterProgrammingMode();
+    
+    try {
+        if (job.getTrconf()) {
+            TrconfFmtParser& trconf = *job.getTrconf();
+            std::vector<TrVerifyBlock> blocks = getCfgBlocks(trconf.getData(), trconf.getRFPMG());
+            std::vector<TrVerifyBlock> written;
+            bool cfg = !isPartCurrent(serial, parts, part, std::vector<TrVerifyBlock>(ledgerSamples ? 1 : 0, blocks[0]));
+            bool rfpmg = !isPartCurrent(serial, parts, part + 1, std::vector<TrVerifyBlock>(ledgerSamples ? 1 : 0, blocks[1]));
+            
+            TrProgressTracker progress(listener, TrPhase::UPLOAD_CFG, 2);
+            if (cfg) {
+                // RFBAND can be read only in programming mode, still before the first write
+                trconf.checkChannels(downloadRFBAND());
+                if (part < parts.size()) {
+                    ledger->invalidate(serial, parts[part]);
+                }
+                channelUpload(CFG_TARGET, TrMessage(trconf.getData()));
+                written.push_back(blocks[0]);
+            }
+            progress.advance(CFG_LEN);
+            if (rfpmg) {
+                if (part + 1 < parts.size()) {
+                    ledger->invalidate(serial, parts[part + 1]);
+                }
+                TrMessage msg;
+                msg.append(trconf.getRFPMG());
+                channelUpload(RFPMG_TARGET, msg);
+                written.push_back(blocks[1]);
+            }
+            progress.advance(1);
+            
+            if ((verifyMode != TrVerifyMode::NONE) && !written.empty()) {
+                verifyWritten(written);
+            }
+            if (cfg) {
+                recordPart(serial, parts, part, std::vector<TrVerifyBlock>(1, blocks[0]), pending);
+            }
+            if (rfpmg) {
+                recordPart(serial, parts, part + 1, std::vector<TrVerifyBlock>(1, blocks[1]), pending);
+            }
+            part += 2;
+        }
+        
+        for (itr = job.hexBegin(); itr != job.hexEnd(); itr++, part++) {
+            if (!isPartCurrent(serial, parts, part, getSampleBlocks((*itr).memory, (*itr).parser, ledgerSamples))) {
+                if (part < parts.size()) {
+                    ledger->invalidate(serial, parts[part]);
+                }
+                uploadHex((*itr).memory, (*itr).parser, 0);
+                recordPart(serial, parts, part, getSampleBlocks((*itr).memory, (*itr).parser, std::max(ledgerSamples, 1u)), 
+                           pending);
+            }
+        }
+        
+        // Special uploads can not be read back, the ledger is trusted
+        if (job.getIqrf() && !isPartCurrent(serial, parts, part, std::vector<TrVerifyBlock>())) {
+            if (part < parts.size()) {
+                ledger->invalidate(serial, parts[part]);
+            }
+            uploadIqrf(*job.getIqrf());
+            recordPart(serial, parts, part, std::vector<TrVerifyBlock>(), pending);
+        }
+        
+        if (verifyMode == TrVerifyMode::DEFERRED) {
+            verify();
+            for (entry = pending.begin(); entry != pending.end(); entry++) {
+                ledger->record(serial, *entry);
+            }
+        }
+        
+        terminateProgrammingMode();
+    } catch (...) {
+        // Parts finished before the failure stay recorded
+        if (ledger) {
+            try {
+                ledger->save();
+            } catch (...) {
+                // Failed save must not hide the original error
+            }
+        }
+        throw;
+    }
+    
+    if (ledger) {
+        ledger->save();
+    }
 }
 
-static void insertAddressData(std::basic_string<unsigned char> &msg, unsigned int addr, 
-				   const std::basic_string<unsigned char>& data) {
-	msg += addr & 0xff;
-    msg += (addr >> 8) &  0xff;
-    msg += data;
+void TrIfc::checkImage(const TrImageOverlay& image) {
+    const TrImage& base = image.getBase();
+    std::vector<std::basic_string<unsigned char>>::const_iterator itr;
+    
+    // Blocks are checked against memory map of the TR
+    readModuleInfo();
+    
+    for (size_t i = 0; i < image.getBlockCount(); i++) {
+        const TrImageBlock& block = image.getBlock(i);
+        // Address in Flash is in 16b words not in bytes
+        unsigned int addr = (block.memory == TrMemory::FLASH) ? block.addr / 2 : block.addr;
+        checkBlock(block.memory, TrDirection::UPLOAD, addr, block.data.length());
+    }
+    
+    if (base.hasIqrf()) {
+        for (itr = base.getRecords().begin(); itr != base.getRecords().end(); itr++) {
+            checkSpecial(*itr);
+        }
+        
+        if (!base.getPrgHeader().validate(getModuleInfo()).isOk()) {
+            TR_THROW_EXCEPTION(TrException, "IQRF plugin of the image can not be upload to TR! TR is not in supported types specified in the IQRF file. This message is caused by incopatible type of TR, OS version or OS build.");
+        }
+    }
 }
 
-void TrIfc::uploadFlash(unsigned int addr, const std::basic_string<unsigned char>& data) {
-    std::basic_string<unsigned char> msg;
+void TrIfc::uploadImage(const TrImageOverlay& image) {
+    const TrImage& base = image.getBase();
+    std::vector<std::basic_string<unsigned char>>::const_iterator itr;
+    std::vector<TrVerifyBlock> blocks;
     
-    // Address in Flash is in 16b words not in bytes
-    addr = addr / 2;
+    // Nothing is written unless the whole image is valid
+    checkImage(image);
     
-    if (addr % FLASH_UP_MODULO != 0) {
-        TR_THROW_EXCEPTION(TrException, "Address in flash memory should be modulo 16!");
-    }
+    enterProgrammingMode();
     
-    if (!(((addr >= FLASH_APP_LOW) && (addr <= FLASH_APP_HIGH)) || ((addr >= FLASH_EXT_LOW) && (addr <= FLASH_EXT_HIGH)))) {
-        TR_THROW_EXCEPTION(TrException, "Address in flash memory is outside application or extended flash memory!");
+    {
+        TrProgressTracker progress(listener, TrPhase::UPLOAD_HEX, image.getBlockCount());
+        for (size_t i = 0; i < image.getBlockCount(); i++) {
+            const TrImageBlock& block = image.getBlock(i);
+            // Address in Flash is in 16b words not in bytes
+            unsigned int addr = (block.memory == TrMemory::FLASH) ? block.addr / 2 : block.addr;
+            sendBlock(static_cast<unsigned char>(getMemoryTarget(block.memory)), addr, block.data);
+            progress.advance(block.data.length());
+            
+            if (verifyMode != TrVerifyMode::NONE) {
+                blocks.push_back(TrVerifyBlock(getMemoryTarget(block.memory), block.addr, block.data));
+            }
+        }
     }
     
-    if (data.length() != FLASH_LEN) {
-        TR_THROW_EXCEPTION(TrException, "Data to be programmed into the flash memory must be 32B long!");
+    if (!blocks.empty()) {
+        verifyWritten(blocks);
     }
     
-    insertAddressData(msg, addr, data);
+    if (base.hasIqrf()) {
+        TrProgressTracker progress(listener, TrPhase::UPLOAD_IQRF, base.getRecords().size());
+        for (itr = base.getRecords().begin(); itr != base.getRecords().end(); itr++) {
+            channelUpload(SPECIAL_TARGET, TrMessage(*itr));
+            progress.advance((*itr).length());
+        }
+    }
     
-    if (!prgMode) {
-        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    if (verifyMode == TrVerifyMode::DEFERRED) {
+        verify();
     }
     
-    ifc->upload(FLASH_TARGET|UPLOAD, msg);
+    terminateProgrammingMode();
 }
 
-void TrIfc::uploadInternalEeprom(unsigned int addr, const std::basic_string<unsigned char>& data) {
-    std::basic_string<unsigned char> msg;
-        
-    if (!((addr >= INT_EEPROM_UP_LOW) && (addr <= INT_EEPROM_UP_HIGH))) {
-        TR_THROW_EXCEPTION(TrException, "Address in internal eeprom memory is outside of addressable range!");
+void TrIfc::checkDelta(const TrDelta& delta) {
+    TrDelta::const_iterator itr;
+    std::vector<TrDeltaBlock>::const_iterator block;
+    std::vector<std::basic_string<unsigned char>>::const_iterator record;
+    
+    // Blocks are checked against memory map of the TR
+    readModuleInfo();
+    
+    for (itr = delta.begin(); itr != delta.end(); itr++) {
+        // Address in Flash is in 16b words not in bytes
+        unsigned int shift = ((*itr).memory == TrMemory::FLASH) ? 1 : 0;
+        for (block = (*itr).blocks.begin(); block != (*itr).blocks.end(); block++) {
+            checkBlock((*itr).memory, TrDirection::UPLOAD, (*block).addr >> shift, (*block).data.length());
+        }
     }
     
-    if (addr + data.length() >= INT_EEPROM_UP_ADDR_LEN_MAX) {
-        TR_THROW_EXCEPTION(TrException, "End of write is out of the addressable range of the internal eeprom!");
+    if (delta.hasIqrf()) {
+        for (record = delta.getRecords().begin(); record != delta.getRecords().end(); record++) {
+            checkSpecial(*record);
+        }
+        
+        if (!delta.getPrgHeader().validate(getModuleInfo()).isOk()) {
+            TR_THROW_EXCEPTION(TrException, "IQRF plugin of the delta can not be upload to TR! TR is not in supported types specified in the IQRF file. This message is caused by incopatible type of TR, OS version or OS build.");
+        }
     }
+}
+
+bool TrIfc::readDeltaSection(const TrDeltaSection& section, std::vector<TrDeltaBlock>& pending) {
+    std::vector<std::pair<unsigned int, unsigned int>>::const_iterator itr;
+    std::vector<TrDeltaBlock>::const_iterator changed = section.blocks.begin();
+    std::basic_string<unsigned char> data;
+    ReadBackBlock block;
+    TrHash hash;
+    size_t blocks = 0;
+    bool valid = true;
     
-    if ((data.length() < INT_EEPROM_UP_LEN_MIN) || (data.length() > INT_EEPROM_UP_LEN_MAX)) {
-        TR_THROW_EXCEPTION(TrException, "Data to be programmed into the internal eeprom memory must be 1-32B long!");
+    for (itr = section.runs.begin(); itr != section.runs.end(); itr++) {
+        blocks += (*itr).second;
     }
     
-    insertAddressData(msg, addr, data);
-    
-    if (!prgMode) {
-        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    TrProgressTracker progress(listener, TrPhase::VERIFY, blocks);
+    // Cache holds uploaded data, read back must reach the TR
+    TrCacheBypass bypass(cache);
+    
+    for (itr = section.runs.begin(); itr != section.runs.end(); itr++) {
+        for (unsigned int i = 0; i < (*itr).second; i++) {
+            unsigned int addr = (*itr).first + i * TR_DIFF_BLOCK_LEN;
+            
+            readBack(section.memory, addr, TR_DIFF_BLOCK_LEN, data, block);
+            progress.advance(data.length());
+            
+            if ((changed == section.blocks.end()) || ((*changed).addr != addr)) {
+                hash.update(data);
+                continue;
+            }
+            
+            // Changed block holds either its new content or its old one
+            if (data != (*changed).data) {
+                TrHash preHash;
+                preHash.update(data);
+                if (preHash.digest() == (*changed).preHash) {
+                    pending.push_back(*changed);
+                } else {
+                    valid = false;
+                }
+            }
+            // Post-image hash confirms also the blocks which did not change
+            hash.update((*changed).data);
+            changed++;
+        }
     }
     
-    ifc->upload(INTERNAL_EEPROM_TARGET|UPLOAD, msg);
+    return valid && (changed == section.blocks.end()) && (hash.digest() == section.postHash);
 }
 
-void TrIfc::uploadExternalEeprom(unsigned int addr, const std::basic_string<unsigned char>& data) {
-    std::basic_string<unsigned char> msg;
+void TrIfc::uploadDelta(const TrDelta& delta) {
+    TrDelta::const_iterator itr;
+    std::vector<std::vector<TrDeltaBlock>> pending;
+    std::vector<TrDeltaBlock>::const_iterator block;
+    std::vector<std::basic_string<unsigned char>>::const_iterator record;
     
-    if (!((addr >= EXT_EEPROM_LOW) && (addr <= EXT_EEPROM_UP_HIGH))) {
-        TR_THROW_EXCEPTION(TrException, "Address in external eeprom memory is outside of addressable range!");
-    }
+    // Nothing is written unless the whole delta is valid
+    checkDelta(delta);
+    
+    enterProgrammingMode();
     
-    if (addr % EXT_EEPROM_MODULO != 0) {
-        TR_THROW_EXCEPTION(TrException, "Address in external eeprom memory should be modulo 32!");
+    // All memories are confirmed before the first write. Blocks already holding
+    // new content were written by earlier, possibly interrupted, application.
+    for (itr = delta.begin(); itr != delta.end(); itr++) {
+        pending.push_back(std::vector<TrDeltaBlock>());
+        if (!readDeltaSection(*itr, pending.back())) {
+            TR_THROW_EXCEPTION(TrException, "Content of " + getTrMemoryName((*itr).memory) + " matches neither the old nor the new image of the delta! Nothing was written by this attempt.");
+        }
     }
     
-    if (data.length() != EXT_EEPROM_LEN) {
-        TR_THROW_EXCEPTION(TrException, "Data to be programmed into the external eeprom memory must be 32B long!");
+    for (itr = delta.begin(); itr != delta.end(); itr++) {
+        const std::vector<TrDeltaBlock>& changes = pending[itr - delta.begin()];
+        if (changes.empty()) {
+            continue;
+        }
+        
+        unsigned char target = static_cast<unsigned char>(getMemoryTarget((*itr).memory));
+        // Address in Flash is in 16b words not in bytes
+        unsigned int shift = ((*itr).memory == TrMemory::FLASH) ? 1 : 0;
+        std::vector<TrVerifyBlock> blocks;
+        TrProgressTracker progress(listener, TrPhase::UPLOAD_HEX, changes.size());
+        
+        for (block = changes.begin(); block != changes.end(); block++) {
+            sendBlock(target, (*block).addr >> shift, (*block).data);
+            progress.advance((*block).data.length());
+            
+            if (verifyMode != TrVerifyMode::NONE) {
+                blocks.push_back(TrVerifyBlock(static_cast<TrTarget>(target), (*block).addr, (*block).data));
+            }
+        }
+        
+        if (!blocks.empty()) {
+            verifyWritten(blocks);
+        }
     }
     
-    insertAddressData(msg, addr, data);
+    if (delta.hasIqrf()) {
+        TrProgressTracker progress(listener, TrPhase::UPLOAD_IQRF, delta.getRecords().size());
+        for (record = delta.getRecords().begin(); record != delta.getRecords().end(); record++) {
+            channelUpload(SPECIAL_TARGET, TrMessage(*record));
+            progress.advance((*record).length());
+        }
+    }
     
-    if (!prgMode) {
-        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+    if (verifyMode == TrVerifyMode::DEFERRED) {
+        verify();
     }
     
-    ifc->upload(EXTERNAL_EEPROM_TARGET|UPLOAD, msg);
+    terminateProgrammingMode();
 }
 
-void TrIfc::uploadSpecial(const std::basic_string<unsigned char>& data) {   
-    if (data.length() != SPECIAL_LEN) {
-        TR_THROW_EXCEPTION(TrException, "Data to be programmed by the special upload must be 18B long!");
-    }
-    
-    if (!prgMode) {
-        TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
-    }
+void TrIfc::uploadDelta(std::string name) {
+    TrDelta delta;
     
-    ifc->upload(SPECIAL_TARGET|UPLOAD, data);
+    delta.load(name);
+    uploadDelta(delta);
 }
 
+void TrIfc::uploadImage(std::shared_ptr<const TrImage> image) {
+    uploadImage(TrImageOverlay(image));
+}
 
-void TrIfc::uploadHex(TrMemory memory, std::string name) {
-    HexFmtParser::iterator itr;
-    
-    HexFmtParser parser(memory, name);
-    
-    parser.parse();
+void TrIfc::checkStream(const TrCommandStream& stream) {
+    const TrModuleInfo& info = getModuleInfo();
     
-    for (itr = parser.begin(); itr != parser.end(); itr++) {
-        switch(memory) {
-            case TrMemory::FLASH:
-                uploadFlash((*itr).addr, (*itr).data);
-                break;
-            case TrMemory::INTERNAL_EEPROM:
-                uploadInternalEeprom((*itr).addr, (*itr).data);
-                break;
-            case TrMemory::EXTERNAL_EEPROM:
-                uploadExternalEeprom((*itr).addr, (*itr).data);
-                break;
-        }
+    if ((info.mcu != stream.getMcu()) || (info.serie != stream.getSerie())) {
+        TR_THROW_EXCEPTION(TrException, "Command stream was compiled for different type of TR!");
     }
 }
 
-static TrModuleInfo getTrModuleInfo(ModuleInfo* moduleInfo) {
-    TrModuleInfo info;
-    
-    info.osVersion = moduleInfo->osVersion;
-    switch(moduleInfo->PICType & 0x7) {
-        case 4:
-            info.mcu = TrMcu::PIC16F1938;
+void TrIfc::executeCommand(const TrCommand& command, const std::string& name) {
+    switch(command.op) {
+        case TrCommandOp::ENTER_PRG_MODE:
+            enterProgrammingMode();
             break;
-        default:
-            TR_THROW_EXCEPTION(TrException, "Unknown type of MCU download from TR: " + std::to_string(moduleInfo->PICType & 0x7) + "!");
+        case TrCommandOp::TERMINATE_PRG_MODE:
+            terminateProgrammingMode();
             break;
-    }
-    
-    info.osBuild = (moduleInfo->osBuild[1] << 8) | moduleInfo->osBuild[0];
-    switch(moduleInfo->PICType >> 4) {
-        case 0:
-        case 1:
-        case 3:
-        case 8:
-        case 9:
-        case 10:
-            info.serie = TrSerie::DCTR_5xD;
+        case TrCommandOp::CHECK_RFBAND:
+            TrconfFmtParser::checkChannels(downloadRFBAND(), command.data, name);
             break;
-        case 2:
-        case 11:
-            info.serie = TrSerie::DCTR_7xD;
+        case TrCommandOp::CHECK_OS:
+            if (!TrCommandStream::checkOs(command, getModuleInfo())) {
+                TR_THROW_EXCEPTION(TrException, "Command stream can not be executed on TR! IQRF plugin of the stream does not support OS version or OS build of the TR.");
+            }
+            break;
+        case TrCommandOp::UPLOAD:
+            if (!prgMode) {
+                TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
+            }
+            channelUpload(static_cast<unsigned char>(command.target), command.msg);
             break;
         default:
-            TR_THROW_EXCEPTION(TrException, "Unknown serie downloaded from TR: " + std::to_string(moduleInfo->PICType >> 4) + "!");
+            TR_THROW_EXCEPTION(TrException, "Unknown command in command stream!");
             break;
     }
-    
-    return info;
 }
 
-void TrIfc::uploadIqrf(std::string name) {
-    IqrfFmtParser::iterator itr;
-    terminateProgrammingMode();
-    TrModuleInfo info = getTrModuleInfo(static_cast<ModuleInfo*>(ifc->getTRModuleInfo()));
-    enterProgrammingMode();
-    IqrfFmtParser parser(name);
-    
-    parser.parse();
+void TrIfc::executeStream(const TrCommandStream& stream) {
+    TrCommandStream::const_iterator itr;
+    TrProgressTracker progress(listener, TrPhase::EXECUTE_STREAM, stream.size());
     
-    if (!parser.check(info)) {
-        TR_THROW_EXCEPTION(TrException, "IQRF file " + name + " can not be upload to TR! TR is not in supported types specified in the IQRF file. This message is caused by incopatible type of TR, OS version or OS build.");
-    }
+    checkStream(stream);
     
-    for (itr = parser.begin(); itr != parser.end(); itr++) {
-        uploadSpecial(*itr);
+    for (itr = stream.begin(); itr != stream.end(); itr++) {
+        executeCommand(*itr, stream.getName());
+        progress.advance((*itr).data.length());
     }
 }
 
-void TrIfc::uploadCfg(std::string name) {
-    unsigned char rfpmg;
-    TrconfFmtParser parser(name);
-    parser.parse();
-    
-    rfpmg = parser.getRFPMG();
-    
-    parser.checkChannels(downloadRFBAND());
-    
-    uploadCfg(parser.getData());
-    uploadRFPMG(rfpmg);
-}
-
 void TrIfc::downloadCfg(std::basic_string<unsigned char>& data) {
-    std::basic_string<unsigned char> msg;
+    TrMessage msg;
     
     if (!prgMode) {
         TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
     }
     
-    ifc->download(CFG_TARGET|DOWNLOAD, msg, data);
+    channelDownload(CFG_TARGET, msg, data);
     
     if (data.length() != CFG_LEN) {
         TR_THROW_EXCEPTION(TrException, "Invalid length of downloaded configuration data!");
@@ -355,89 +1507,77 @@ void TrIfc::downloadCfg(std::basic_string<unsigned char>& data) {
 }
 
 unsigned char TrIfc::downloadRFPMG() {
-    std::basic_string<unsigned char> msg;
+    TrMessage msg;
     std::basic_string<unsigned char> data;
     
     if (!prgMode) {
         TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
     }
     
-    ifc->download(RFPMG_TARGET|DOWNLOAD, msg, data);
+    channelDownload(RFPMG_TARGET, msg, data);
     return data[0];
 }
 unsigned char TrIfc::downloadRFBAND() {
-    std::basic_string<unsigned char> msg;
+    TrMessage msg;
     std::basic_string<unsigned char> data;
     
     if (!prgMode) {
         TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
     }
     
-    ifc->download(RFBAND_TARGET|DOWNLOAD, msg, data);
+    channelDownload(RFBAND_TARGET, msg, data);
     return data[0];
 }
 
 void TrIfc::downloadFlash(unsigned int addr, std::basic_string<unsigned char>& data) {
-    std::basic_string<unsigned char> msg;
-    
-    if (addr % FLASH_DOWN_MODULO != 0) {
-        TR_THROW_EXCEPTION(TrException, "Address in flash memory should be modulo 16!");
-    }
+    TrMessage msg;
     
-    if (!(((addr >= FLASH_APP_LOW) && (addr <= FLASH_APP_HIGH)) || ((addr >= FLASH_EXT_LOW) && (addr <= FLASH_EXT_HIGH)))) {
-        TR_THROW_EXCEPTION(TrException, "Address in flash memory is outside application or extended flash memory!");
-    }
+    checkBlock(TrMemory::FLASH, TrDirection::DOWNLOAD, addr, 0);
        
-    insertAddress(msg, addr);
+    msg.appendAddress(addr);
 	
     if (!prgMode) {
         TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
     }
     
-    ifc->download(FLASH_TARGET|DOWNLOAD, msg, data);
+    channelDownload(FLASH_TARGET, msg, data);
 }
 
 void TrIfc::downloadInternalEeprom(unsigned int addr, std::basic_string<unsigned char>& data) {
-    std::basic_string<unsigned char> msg;
+    TrMessage msg;
+    
+    // Download must see buffered writes
+    flush();
         
-    if (!((addr >= INT_EEPROM_DOWN_LOW) && (addr <= INT_EEPROM_DOWN_HIGH))) {
-        TR_THROW_EXCEPTION(TrException, "Address in internal eeprom memory is outside of addressable range!");
-    }
+    checkBlock(TrMemory::INTERNAL_EEPROM, TrDirection::DOWNLOAD, addr, 0);
         
-    insertAddress(msg, addr);
+    msg.appendAddress(addr);
     
     if (!prgMode) {
         TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
     }
     
-    ifc->download(INTERNAL_EEPROM_TARGET|DOWNLOAD, msg, data);
+    channelDownload(INTERNAL_EEPROM_TARGET, msg, data);
 	
-	if (data.length() != INT_EEPROM_DOWN_LEN) {
-        TR_THROW_EXCEPTION(TrException, "Data from internal eeprom memory must be 32B long!");
-    }
+    checkBlock(TrMemory::INTERNAL_EEPROM, TrDirection::DOWNLOAD, addr, data.length());
 }
 void TrIfc::downloadExternalEeprom(unsigned int addr, std::basic_string<unsigned char>& data) {
-    std::basic_string<unsigned char> msg;
+    TrMessage msg;
     
-    if (!((addr >= EXT_EEPROM_LOW) && (addr <= EXT_EEPROM_DOWN_HIGH))) {
-        TR_THROW_EXCEPTION(TrException, "Address in external eeprom memory is outside of addressable range!");
-    }
+    // Download must see buffered writes
+    flush();
     
-    if (addr % EXT_EEPROM_MODULO != 0) {
-        TR_THROW_EXCEPTION(TrException, "Address in external eeprom memory should be modulo 32!");
-    }
+    checkBlock(TrMemory::EXTERNAL_EEPROM, TrDirection::DOWNLOAD, addr, 0);
     
-    insertAddress(msg, addr);
+    msg.appendAddress(addr);
     
     if (!prgMode) {
         TR_THROW_EXCEPTION(TrException, "TR is not in programming mode!");
     }
     
-    ifc->download(EXTERNAL_EEPROM_TARGET|DOWNLOAD, msg, data);
+    channelDownload(EXTERNAL_EEPROM_TARGET, msg, data);
 	
-	if (data.length() != EXT_EEPROM_LEN) {
-        TR_THROW_EXCEPTION(TrException, "Data from external eeprom memory must be 32B long!");
-    }
+    checkBlock(TrMemory::EXTERNAL_EEPROM, TrDirection::DOWNLOAD, addr, data.length());
 }
 
 void TrIfc::downloadCfg(std::string name) {
@@ -456,30 +1596,303 @@ void TrIfc::downloadCfg(std::string name) {
     }
 }
 
-void TrIfc::downloadHex(TrMemory memory, unsigned int addr, size_t len, std::string name) {
-    HexFmtParser parser(memory, name);
+void TrIfc::downloadHex(TrMemory memory, unsigned int addr, size_t len, std::string name, bool elide) {
+    HexFmtWriter writer(name);
+    TrRingBuffer<HexDataRecord> ring(DOWNLOAD_RING_LEN, HexDataRecord(0, std::basic_string<unsigned char>()));
+    std::exception_ptr error;
+    uint16_t fill = getTrFillPattern(memory);
+    TrProgressTracker progress(listener, TrPhase::DOWNLOAD_HEX, (len + 31) / 32);
+    
+    // Records are written to the file while next blocks are downloaded
+    std::thread thread([&]() {
+        HexDataRecord record(0, std::basic_string<unsigned char>());
+        try {
+            while (ring.pop(record)) {
+                writer.write(record.addr, record.data);
+            }
+            if (!ring.isAborted()) {
+                writer.close();
+            }
+        } catch (...) {
+            error = std::current_exception();
+            ring.abort();
+        }
+    });
     
-    for (size_t i = addr; i < addr + len; i+= 32) {
-        std::basic_string<unsigned char> data;
-        data.resize(32);
+    try {
+        HexDataRecord record(0, std::basic_string<unsigned char>());
         
-        switch(memory) {
-            case TrMemory::FLASH:
-                downloadFlash(i, data);
+        for (size_t i = addr; i < addr + len; i+= 32) {
+            std::basic_string<unsigned char>& data = record.data;
+            data.resize(32);
+            
+            switch(memory) {
+                case TrMemory::FLASH:
+                    downloadFlash(i, data);
+                    break;
+                case TrMemory::INTERNAL_EEPROM:
+                    downloadInternalEeprom(i, data);
+                    break;
+                case TrMemory::EXTERNAL_EEPROM:
+                    downloadExternalEeprom(i, data);
+                    break;
+            }
+            // Truncate last memory block
+            if ((i + 32) > addr + len) {
+                data.resize(addr + len - i);
+            }
+            progress.advance(data.length());
+            // Pass the record to the writer thread
+            if (!elide || !isTrFillBlock(data.data(), data.length(), fill)) {
+                record.addr = i;
+                if (!ring.push(record)) {
+                    break;
+                }
+            }
+        }
+    } catch (...) {
+        ring.abort();
+        thread.join();
+        throw;
+    }
+    
+    ring.close();
+    thread.join();
+    
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Downloads of flash return whole modulo, downloads of eeprom return lenMax bytes
+static unsigned int getSnapshotStep(const TrMemoryRegion& region) {
+    return std::max(region.modulo, static_cast<unsigned int>(region.lenMax));
+}
+
+void TrIfc::snapshot(std::string name) {
+    TrSnapshotWriter writer(name, getModuleInfo());
+    
+    snapshot(writer);
+    writer.close();
+}
+
+void TrIfc::snapshot(TrSnapshotStore& store, std::string name) {
+    TrSnapshotStoreWriter writer(store, name, getModuleInfo());
+    
+    snapshot(writer);
+    writer.close();
+}
+
+void TrIfc::snapshot(TrSnapshotSink& writer) {
+    TrMessage msg;
+    std::basic_string<unsigned char> data;
+    size_t blocks = 3;
+    
+    enterProgrammingMode();
+    
+    for (size_t i = 0; i < memoryMap->count; i++) {
+        const TrMemoryRegion& region = memoryMap->regions[i];
+        if (region.direction == TrDirection::DOWNLOAD) {
+            blocks += (region.high - region.low) / getSnapshotStep(region) + 1;
+        }
+    }
+    
+    TrProgressTracker progress(listener, TrPhase::SNAPSHOT, blocks);
+    
+    // Configuration is stored as it is, even with invalid checksum
+    writer.beginRegion(TrTarget::CFG, 0, 0);
+    channelDownload(CFG_TARGET, msg, data);
+    writer.writeBlock(data);
+    writer.endRegion();
+    progress.advance(data.length());
+    
+    writer.beginRegion(TrTarget::RFPMG, 0, 0);
+    writer.writeBlock(std::basic_string<unsigned char>(1, downloadRFPMG()));
+    writer.endRegion();
+    progress.advance(1);
+    
+    writer.beginRegion(TrTarget::RFBAND, 0, 0);
+    writer.writeBlock(std::basic_string<unsigned char>(1, downloadRFBAND()));
+    writer.endRegion();
+    progress.advance(1);
+    
+    for (size_t i = 0; i < memoryMap->count; i++) {
+        const TrMemoryRegion& region = memoryMap->regions[i];
+        unsigned int step = getSnapshotStep(region);
+        
+        if (region.direction != TrDirection::DOWNLOAD) {
+            continue;
+        }
+        
+        writer.beginRegion(getMemoryTarget(region.memory), region.low, step, 
+                           true, getTrFillPattern(region.memory));
+        for (unsigned int addr = region.low; addr <= region.high; addr += step) {
+            switch(region.memory) {
+                case TrMemory::FLASH:
+                    downloadFlash(addr, data);
+                    break;
+                case TrMemory::INTERNAL_EEPROM:
+                    downloadInternalEeprom(addr, data);
+                    break;
+                case TrMemory::EXTERNAL_EEPROM:
+                    downloadExternalEeprom(addr, data);
+                    break;
+                default:
+                    TR_THROW_EXCEPTION(TrException, "Invalid TR memory type for snapshot!");
+                    break;
+            }
+            writer.writeBlock(data);
+            progress.advance(data.length());
+        }
+        writer.endRegion();
+    }
+}
+
+size_t TrIfc::restoreBlock(TrMemory memory, unsigned int addr, const std::basic_string<unsigned char>& live, 
+                           const std::basic_string<unsigned char>& block) {
+    unsigned char target = static_cast<unsigned char>(getMemoryTarget(memory));
+    // Address in Flash is in 16b words not in bytes
+    unsigned int unit = (memory == TrMemory::FLASH) ? 2 : 1;
+    size_t skipped = 0;
+    size_t offset = 0;
+    
+    // Downloaded block is uploaded in parts allowed by the memory map
+    while (offset < block.length()) {
+        unsigned int part = addr + offset / unit;
+        const TrMemoryRegion* region = memoryMap->find(memory, TrDirection::UPLOAD, part);
+        size_t len = block.length() - offset;
+        
+        if (region != nullptr) {
+            if ((region->lenMax != 0) && (region->lenMax < len)) {
+                len = region->lenMax;
+            }
+            if ((region->end != 0) && (part + len / unit >= region->end)) {
+                len = (region->end > part + 1) ? (region->end - part - 1) * unit : 0;
+            }
+        }
+        
+        if ((region == nullptr) || (len == 0)) {
+            // Rest of the block can not be written
+            if (live.compare(offset, std::string::npos, block, offset, std::string::npos) != 0) {
+                skipped++;
+            }
+            break;
+        }
+        
+        if (live.compare(offset, len, block, offset, len) != 0) {
+            if (memoryMap->check(memory, TrDirection::UPLOAD, part, len) == TrMemoryCheck::OK) {
+                sendBlock(target, part, block.data() + offset, len);
+            } else {
+                skipped++;
+            }
+        }
+        offset += len;
+    }
+    
+    return skipped;
+}
+
+void TrIfc::restore(std::string name) {
+    TrSnapshot snapshot;
+    
+    snapshot.load(name);
+    restore(snapshot, name);
+}
+
+void TrIfc::restore(TrSnapshotStore& store, std::string name) {
+    TrSnapshot snapshot;
+    
+    store.get(name, snapshot);
+    restore(snapshot, name);
+}
+
+void TrIfc::restore(const TrSnapshot& snapshot, const std::string& name) {
+    TrSnapshot::const_iterator itr;
+    TrMessage msg;
+    std::basic_string<unsigned char> live;
+    size_t blocks = 0;
+    size_t skipped = 0;
+    
+    const TrModuleInfo& info = getModuleInfo();
+    const TrModuleInfo& saved = snapshot.getModuleInfo();
+    if ((info.mcu != saved.mcu) || (info.serie != saved.serie) || (info.osVersion != saved.osVersion) || 
+        (info.osBuild != saved.osBuild)) {
+        TR_THROW_EXCEPTION(TrException, "Snapshot " + name + " was taken from TR of different type or with different OS version or OS build!");
+    }
+    
+    // Nothing is written unless all regions have valid length
+    for (itr = snapshot.begin(); itr != snapshot.end(); itr++) {
+        if (((*itr).target == TrTarget::CFG) && ((*itr).data.length() != CFG_LEN)) {
+            TR_THROW_EXCEPTION(TrException, "Invalid length of the TR HWP configuration in snapshot " + name + "!");
+        }
+        if ((((*itr).target == TrTarget::RFPMG) || ((*itr).target == TrTarget::RFBAND)) && ((*itr).data.length() != 1)) {
+            TR_THROW_EXCEPTION(TrException, "Invalid length of " + getTargetName((*itr).target) + " in snapshot " + name + "!");
+        }
+        blocks += (*itr).getBlockCount();
+    }
+    
+    enterProgrammingMode();
+    
+    TrProgressTracker progress(listener, TrPhase::RESTORE, blocks);
+    
+    for (itr = snapshot.begin(); itr != snapshot.end(); itr++) {
+        const TrSnapshotRegion& region = *itr;
+        
+        switch(region.target) {
+            case TrTarget::CFG:
+                channelDownload(CFG_TARGET, msg, live);
+                // Snapshot keeps the configuration as it was read, even with invalid checksum
+                if (live != region.data) {
+                    channelUpload(CFG_TARGET, TrMessage(region.data));
+                }
+                progress.advance(region.data.length());
                 break;
-            case TrMemory::INTERNAL_EEPROM:
-                downloadInternalEeprom(i, data);
+            case TrTarget::RFPMG:
+                if (downloadRFPMG() != region.data[0]) {
+                    uploadRFPMG(region.data[0]);
+                }
+                progress.advance(1);
                 break;
-            case TrMemory::EXTERNAL_EEPROM:
-                downloadExternalEeprom(i, data);
+            case TrTarget::RFBAND:
+                if (downloadRFBAND() != region.data[0]) {
+                    uploadRFBAND(region.data[0]);
+                }
+                progress.advance(1);
+                break;
+            case TrTarget::FLASH:
+            case TrTarget::INTERNAL_EEPROM:
+            case TrTarget::EXTERNAL_EEPROM: {
+                TrMemory memory = getTargetMemory(region.target);
+                for (size_t i = 0; i < region.getBlockCount(); i++) {
+                    unsigned int addr = region.addr + i * region.step;
+                    std::basic_string<unsigned char> block = region.data.substr(i * region.blockLen, region.blockLen);
+                    switch(memory) {
+                        case TrMemory::FLASH:
+                            downloadFlash(addr, live);
+                            break;
+                        case TrMemory::INTERNAL_EEPROM:
+                            downloadInternalEeprom(addr, live);
+                            break;
+                        default:
+                            downloadExternalEeprom(addr, live);
+                            break;
+                    }
+                    if (live != block) {
+                        skipped += restoreBlock(memory, addr, live, block);
+                    }
+                    progress.advance(block.length());
+                }
+                break;
+            }
+            default:
+                TR_THROW_EXCEPTION(TrException, "Invalid region in snapshot " + name + "!");
                 break;
         }
-        // Truncate last memory block
-        if ((i + 32) > addr + len) {
-            data.resize(addr + len - i);
-        }
-        // Push back into Hex file internal representation
-        parser.pushBack(i, data);
     }
-    parser.save();
+    
+    if (skipped > 0) {
+        std::vector<TrNote> notes;
+        notes.push_back(TrNote(TrSeverity::WARNING, name, 0, std::to_string(skipped) + " differing parts of TR memory are not writable and were not restored!"));
+        reportNotes(listener, notes);
+    }
 }
@@ -0,0 +1,102 @@
+/*
+ * Immutable firmware image shared by programming sessions.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <TrException.h>
+#include <TrImage.h>
+
+void TrImage::findBlocks(TrMemory memory, unsigned int addr, size_t len, std::vector<size_t>& found) const {
+    std::map<std::pair<TrMemory, unsigned int>, size_t>::const_iterator itr;
+    unsigned int first = (addr > blockLenMax) ? addr - blockLenMax : 0;
+    unsigned int end = addr + len;
+
+    found.clear();
+    for (itr = index.lower_bound(std::make_pair(memory, first)); itr != index.end(); itr++) {
+        const TrImageBlock& block = blocks[(*itr).second];
+
+        if (((*itr).first.first != memory) || (block.addr >= end)) {
+            break;
+        }
+        if (block.addr + block.data.length() > addr) {
+            found.push_back((*itr).second);
+        }
+    }
+}
+
+void TrImageBuilder::addHex(TrMemory memory, HexFmtParser& parser) {
+    HexFmtParser::iterator itr;
+
+    for (itr = parser.begin(); itr != parser.end(); itr++) {
+        image->index[std::make_pair(memory, (*itr).addr)] = image->blocks.size();
+        image->blocks.push_back(TrImageBlock(memory, (*itr).addr, (*itr).data));
+        image->blockLenMax = std::max(image->blockLenMax, (*itr).data.length());
+    }
+}
+
+void TrImageBuilder::setIqrf(IqrfFmtParser& parser) {
+    image->records.assign(parser.begin(), parser.end());
+    image->prgHeader = parser.getPrgHeader();
+    image->iqrf = true;
+}
+
+std::shared_ptr<const TrImage> TrImageBuilder::build() {
+    std::shared_ptr<const TrImage> built = image;
+
+    image.reset(new TrImage());
+    return built;
+}
+
+TrImageOverlay::TrImageOverlay(std::shared_ptr<const TrImage> image) : base(image) {
+    if (!base) {
+        TR_THROW_EXCEPTION(TrException, "Image of overlay is not set!");
+    }
+}
+
+void TrImageOverlay::patch(TrMemory memory, unsigned int addr, const std::basic_string<unsigned char>& data) {
+    std::vector<size_t> found;
+    std::vector<bool> covered(data.length(), false);
+    std::vector<size_t>::iterator itr;
+
+    base->findBlocks(memory, addr, data.length(), found);
+
+    // Whole patch is checked before any block is copied
+    for (itr = found.begin(); itr != found.end(); itr++) {
+        const TrImageBlock& block = base->getBlock(*itr);
+        unsigned int from = std::max(block.addr, addr);
+        unsigned int to = std::min(static_cast<unsigned int>(block.addr + block.data.length()), static_cast<unsigned int>(addr + data.length()));
+        std::fill(covered.begin() + (from - addr), covered.begin() + (to - addr), true);
+    }
+
+    if (std::find(covered.begin(), covered.end(), false) != covered.end()) {
+        TR_THROW_EXCEPTION(TrException, "Patch at address " + std::to_string(addr) + " is not inside blocks of the image!");
+    }
+
+    for (itr = found.begin(); itr != found.end(); itr++) {
+        std::map<size_t, TrImageBlock>::iterator copy = patched.find(*itr);
+
+        // Block is copied on its first patch
+        if (copy == patched.end()) {
+            copy = patched.insert(std::make_pair(*itr, base->getBlock(*itr))).first;
+        }
+
+        TrImageBlock& block = (*copy).second;
+        unsigned int from = std::max(block.addr, addr);
+        unsigned int to = std::min(static_cast<unsigned int>(block.addr + block.data.length()), static_cast<unsigned int>(addr + data.length()));
+        std::copy(data.begin() + (from - addr), data.begin() + (to - addr), block.data.begin() + (from - block.addr));
+    }
+}
+
+const TrImageBlock& TrImageOverlay::getBlock(size_t i) const {
+    std::map<size_t, TrImageBlock>::const_iterator itr = patched.find(i);
+
+    if (itr != patched.end()) {
+        return (*itr).second;
+    }
+    return base->getBlock(i);
+}
@@ -0,0 +1,42 @@
+/*
+ * Programming job - files programmed into TR in one session.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <TrJob.h>
+
+void TrJob::setTrconf(std::string name) {
+    trconf.reset(new TrconfFmtParser(name));
+    parsed = false;
+}
+
+void TrJob::addHex(TrMemory memory, std::string name) {
+    hex.push_back(TrJobHex(memory, name));
+    parsed = false;
+}
+
+void TrJob::setIqrf(std::string name) {
+    iqrf.reset(new IqrfFmtParser(name));
+    parsed = false;
+}
+
+void TrJob::parse(TrListener* listener) {
+    std::vector<TrJobHex>::iterator itr;
+
+    if (trconf) {
+        trconf->parse();
+    }
+
+    for (itr = hex.begin(); itr != hex.end(); itr++) {
+        (*itr).parser.setListener(listener);
+        (*itr).parser.parse();
+    }
+
+    if (iqrf) {
+        iqrf->setListener(listener);
+        iqrf->parse();
+    }
+
+    parsed = true;
+}
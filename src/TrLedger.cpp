@@ -0,0 +1,151 @@
+/*
+ * Ledger of content programmed into TR devices.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <algorithm>
+
+#include <TrException.h>
+#include <TrLedger.h>
+#include "binary_operations.h"
+
+static const char LEDGER_MAGIC[4]         = {'T', 'R', 'L', 'G'};
+static const unsigned char LEDGER_VERSION = 1;
+static const size_t LEDGER_HEADER_LEN     = 12;
+static const size_t LEDGER_ENTRY_LEN      = 24;
+
+// Regions of items other than HEX files are whole, 0 - 0
+static bool isOverlapping(const TrLedgerEntry& a, const TrLedgerEntry& b) {
+    if (a.item != b.item) {
+        return false;
+    }
+    if ((a.addr == b.addr) && (a.end == b.end)) {
+        return true;
+    }
+    return (a.addr < b.end) && (b.addr < a.end);
+}
+
+bool TrLedger::load() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ifstream infile(file_name, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+    const unsigned char* buffer = reinterpret_cast<const unsigned char*>(content.data());
+    size_t count;
+
+    devices.clear();
+
+    if ((content.length() < LEDGER_HEADER_LEN) || !std::equal(LEDGER_MAGIC, LEDGER_MAGIC + 4, content.begin()) ||
+        (buffer[4] != LEDGER_VERSION)) {
+        return false;
+    }
+
+    count = getValue(buffer + 8, 4);
+    if (content.length() != LEDGER_HEADER_LEN + count * LEDGER_ENTRY_LEN) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const unsigned char* bptr = buffer + LEDGER_HEADER_LEN + i * LEDGER_ENTRY_LEN;
+        TrLedgerEntry entry(static_cast<TrLedgerItem>(bptr[4]), getValue(bptr + 8, 4), getValue(bptr + 12, 4), getValue(bptr + 16, 8));
+        devices[getValue(bptr, 4)].push_back(entry);
+    }
+
+    return true;
+}
+
+void TrLedger::save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<TrSerial, std::vector<TrLedgerEntry>>::const_iterator ditr;
+    std::vector<TrLedgerEntry>::const_iterator eitr;
+    std::string content(LEDGER_HEADER_LEN, '\0');
+    std::string temp_name = file_name + ".tmp";
+    size_t count = 0;
+
+    for (ditr = devices.begin(); ditr != devices.end(); ditr++) {
+        for (eitr = (*ditr).second.begin(); eitr != (*ditr).second.end(); eitr++) {
+            unsigned char entry[LEDGER_ENTRY_LEN] = {0};
+            putValue(entry, (*ditr).first, 4);
+            entry[4] = static_cast<unsigned char>((*eitr).item);
+            putValue(entry + 8, (*eitr).addr, 4);
+            putValue(entry + 12, (*eitr).end, 4);
+            putValue(entry + 16, (*eitr).hash, 8);
+            content.append(reinterpret_cast<const char*>(entry), LEDGER_ENTRY_LEN);
+            count++;
+        }
+    }
+
+    unsigned char* header = reinterpret_cast<unsigned char*>(&content[0]);
+    std::copy_n(LEDGER_MAGIC, 4, content.begin());
+    header[4] = LEDGER_VERSION;
+    putValue(header + 8, count, 4);
+
+    // Ledger is written aside and renamed, so an interrupted save keeps the old one
+    std::ofstream outfile(temp_name, std::ios::binary | std::ios::trunc);
+    if (!outfile.write(content.data(), content.length()) || !outfile.flush()) {
+        TR_THROW_EXCEPTION(TrException, "Can not write ledger " + temp_name + "!");
+    }
+    outfile.close();
+
+    if (std::rename(temp_name.c_str(), file_name.c_str()) != 0) {
+        TR_THROW_EXCEPTION(TrException, "Can not replace ledger " + file_name + "!");
+    }
+}
+
+bool TrLedger::isCurrent(TrSerial serial, const TrLedgerEntry& entry) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<TrSerial, std::vector<TrLedgerEntry>>::const_iterator device = devices.find(serial);
+    std::vector<TrLedgerEntry>::const_iterator itr;
+
+    if (device == devices.end()) {
+        return false;
+    }
+
+    for (itr = (*device).second.begin(); itr != (*device).second.end(); itr++) {
+        if (((*itr).item == entry.item) && ((*itr).addr == entry.addr) && ((*itr).end == entry.end)) {
+            return (*itr).hash == entry.hash;
+        }
+    }
+    return false;
+}
+
+void TrLedger::record(TrSerial serial, const TrLedgerEntry& entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<TrLedgerEntry>& entries = devices[serial];
+
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&entry](const TrLedgerEntry& e) {
+        return isOverlapping(e, entry);
+    }), entries.end());
+    entries.push_back(entry);
+}
+
+void TrLedger::invalidate(TrSerial serial, const TrLedgerEntry& entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<TrSerial, std::vector<TrLedgerEntry>>::iterator device = devices.find(serial);
+
+    if (device == devices.end()) {
+        return;
+    }
+
+    std::vector<TrLedgerEntry>& entries = (*device).second;
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&entry](const TrLedgerEntry& e) {
+        return isOverlapping(e, entry);
+    }), entries.end());
+}
+
+void TrLedger::forget(TrSerial serial) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    devices.erase(serial);
+}
+
+size_t TrLedger::getDeviceCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return devices.size();
+}
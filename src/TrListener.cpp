@@ -0,0 +1,54 @@
+/*
+ * Progress and event reporting of TR interface and file format parsers.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <iostream>
+#include <algorithm>
+
+#include <TrListener.h>
+
+void reportNotes(TrListener* listener, const std::vector<TrNote>& notes) {
+    std::vector<TrNote>::const_iterator itr;
+
+    if (notes.empty()) {
+        return;
+    }
+
+    if (listener) {
+        listener->onNotes(notes);
+        return;
+    }
+
+    for (itr = notes.begin(); itr != notes.end(); itr++) {
+        std::cerr << ((*itr).severity == TrSeverity::WARNING ? "Warning: " : "Note: ") << (*itr).text << "\n";
+    }
+}
+
+TrProgressTracker::TrProgressTracker(TrListener* listener, TrPhase phase, size_t total, size_t done) 
+    : listener(listener), first(done), next(done), start(std::chrono::steady_clock::now()) {
+    progress.phase = phase;
+    progress.done = done;
+    progress.total = total;
+    progress.bytes = 0;
+    progress.eta = 0;
+
+    if (listener) {
+        listener->onPhase(phase);
+        next = done + 1;
+    }
+}
+
+void TrProgressTracker::report() {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t step = progress.total / 100;
+
+    if (progress.done > first) {
+        progress.eta = elapsed / (progress.done - first) * (progress.total - progress.done);
+    }
+    listener->onProgress(progress);
+
+    // Last block is always reported
+    next = std::min(progress.done + (step ? step : 1), progress.total);
+}
@@ -0,0 +1,76 @@
+/*
+ * Memory maps of TR modules.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <TrMemoryMap.h>
+
+constexpr TrMemoryMap TrMemoryMapTraits<TrMcu::PIC16F1938, TrSerie::DCTR_5xD>::map;
+constexpr TrMemoryMap TrMemoryMapTraits<TrMcu::PIC16F1938, TrSerie::DCTR_7xD>::map;
+
+static const TrMemoryMap* const MEMORY_MAPS[] = {
+    &TrMemoryMapTraits<TrMcu::PIC16F1938, TrSerie::DCTR_5xD>::map,
+    &TrMemoryMapTraits<TrMcu::PIC16F1938, TrSerie::DCTR_7xD>::map
+};
+
+const TrMemoryRegion* TrMemoryMap::find(TrMemory memory, TrDirection direction, unsigned int addr) const {
+    for (size_t i = 0; i < count; i++) {
+        const TrMemoryRegion& region = regions[i];
+        if ((region.memory == memory) && (region.direction == direction) && (addr >= region.low) && (addr <= region.high)) {
+            return &region;
+        }
+    }
+    return nullptr;
+}
+
+TrMemoryCheck TrMemoryMap::check(TrMemory memory, TrDirection direction, unsigned int addr, size_t len) const {
+    const TrMemoryRegion* region = find(memory, direction, addr);
+
+    if (region == nullptr) {
+        return TrMemoryCheck::OUT_OF_RANGE;
+    }
+
+    if (addr % region->modulo != 0) {
+        return TrMemoryCheck::MISALIGNED;
+    }
+
+    if (len == 0) {
+        return TrMemoryCheck::OK;
+    }
+
+    if ((region->end != 0) && (addr + len >= region->end)) {
+        return TrMemoryCheck::END_OUT_OF_RANGE;
+    }
+
+    if ((region->lenMin != 0) && ((len < region->lenMin) || (len > region->lenMax))) {
+        return TrMemoryCheck::INVALID_LENGTH;
+    }
+
+    return TrMemoryCheck::OK;
+}
+
+const TrMemoryRegion* TrMemoryMap::findDownload(TrMemory memory, unsigned int addr, unsigned int& base) const {
+    const TrMemoryRegion* region = find(memory, TrDirection::DOWNLOAD, addr);
+
+    if ((region == nullptr) && (memory == TrMemory::INTERNAL_EEPROM)) {
+        region = find(memory, TrDirection::DOWNLOAD, 0);
+        if (region != nullptr) {
+            addr = region->high;
+        }
+    }
+
+    if (region != nullptr) {
+        base = addr - addr % region->modulo;
+    }
+    return region;
+}
+
+const TrMemoryMap* getTrMemoryMap(TrMcu mcu, TrSerie serie) {
+    for (size_t i = 0; i < sizeof(MEMORY_MAPS) / sizeof(MEMORY_MAPS[0]); i++) {
+        if ((MEMORY_MAPS[i]->mcu == mcu) && (MEMORY_MAPS[i]->serie == serie)) {
+            return MEMORY_MAPS[i];
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,204 @@
+/*
+ * Dry-run planning of programming jobs.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <string>
+#include <algorithm>
+
+#include <TrException.h>
+#include <TrPlanner.h>
+#include "tr_protocol.h"
+
+TrLatencyModel TrLatencyModel::getDefault(TrChannelType type) {
+    TrLatencyModel model;
+
+    switch(type) {
+        case TrChannelType::CDC:
+            model.moduleInfo = 20000;
+            model.enterMode = 200000;
+            model.terminateMode = 200000;
+            model.perByte = 10;
+            model.perTransaction.fill(10000);
+            break;
+        case TrChannelType::SPI:
+            model.moduleInfo = 10000;
+            model.enterMode = 150000;
+            model.terminateMode = 150000;
+            model.perByte = 40;
+            model.perTransaction.fill(5000);
+            break;
+    }
+
+    // Writes of flash and external eeprom blocks dominate programming time
+    model.perTransaction[static_cast<size_t>(TrTarget::FLASH)] += 20000;
+    model.perTransaction[static_cast<size_t>(TrTarget::EXTERNAL_EEPROM)] += 10000;
+
+    return model;
+}
+
+void TrLatencyModel::calibrate(const TrStats& stats) {
+    for (size_t i = 0; i < TR_TARGET_COUNT; i++) {
+        const TrTargetStats& target = stats.get(static_cast<TrTarget>(i));
+        uint64_t count = target.uploads + target.downloads;
+        if (count == 0) {
+            continue;
+        }
+        double bytes = static_cast<double>(target.uploadBytes + target.downloadBytes) / count;
+        double transaction = target.latency.mean() - perByte * bytes;
+        perTransaction[i] = (transaction > 0) ? transaction : 0;
+    }
+
+    if (stats.getEnterMode().count() > 0) {
+        enterMode = stats.getEnterMode().mean();
+    }
+    if (stats.getTerminateMode().count() > 0) {
+        terminateMode = stats.getTerminateMode().mean();
+    }
+}
+
+double TrLatencyModel::estimate(const TrTransaction& transaction) const {
+    switch(transaction.operation) {
+        case TrOperation::MODULE_INFO:
+            return moduleInfo;
+        case TrOperation::ENTER_PRG_MODE:
+            return enterMode;
+        case TrOperation::TERMINATE_PRG_MODE:
+            return terminateMode;
+        default:
+            return perTransaction[static_cast<size_t>(transaction.target)] + perByte * transaction.len;
+    }
+}
+
+double TrPlan::estimate(const TrLatencyModel& model) const {
+    double us = 0;
+
+    for (const_iterator itr = begin(); itr != end(); itr++) {
+        us += model.estimate(*itr);
+    }
+    return us / 1000000.0;
+}
+
+void TrPlanner::planVerify(const std::vector<TrVerifyBlock>& written, std::vector<TrVerifyBlock>& deferred, 
+                           TrPlan& plan) const {
+    std::vector<TrVerifyBlock> sampled;
+    std::vector<TrVerifyBlock>::const_iterator itr;
+
+    switch(verifyMode) {
+        case TrVerifyMode::NONE:
+            break;
+        case TrVerifyMode::FULL:
+            planReadBack(written, plan);
+            break;
+        case TrVerifyMode::SAMPLED:
+            for (itr = written.begin(); itr != written.end(); itr++) {
+                if (isTrBlockSampled((*itr).target, (*itr).addr, verifyPercent)) {
+                    sampled.push_back(*itr);
+                }
+            }
+            planReadBack(sampled, plan);
+            break;
+        case TrVerifyMode::DEFERRED:
+            deferred.insert(deferred.end(), written.begin(), written.end());
+            break;
+    }
+}
+
+// Blocks in one downloaded block are read back by a single download, as in TrIfc::verifyBlocks
+void TrPlanner::planReadBack(std::vector<TrVerifyBlock> blocks, TrPlan& plan) const {
+    std::vector<TrVerifyBlock>::const_iterator itr;
+    TrMemory last = TrMemory::ERROR;
+    unsigned int lastBase = 0;
+
+    std::stable_sort(blocks.begin(), blocks.end(), [](const TrVerifyBlock& a, const TrVerifyBlock& b) {
+        return (a.target < b.target) || ((a.target == b.target) && (a.addr < b.addr));
+    });
+
+    for (itr = blocks.begin(); itr != blocks.end(); itr++) {
+        if ((*itr).target == TrTarget::CFG) {
+            plan.add(TrTransaction(TrOperation::DOWNLOAD, TrTarget::CFG, 0, CFG_LEN));
+            continue;
+        }
+        if ((*itr).target == TrTarget::RFPMG) {
+            plan.add(TrTransaction(TrOperation::DOWNLOAD, TrTarget::RFPMG, 0, RFPMG_LEN));
+            continue;
+        }
+
+        TrMemory memory = getTargetMemory((*itr).target);
+        // Address in Flash is in 16b words not in bytes
+        unsigned int addr = (memory == TrMemory::FLASH) ? (*itr).addr / 2 : (*itr).addr;
+        unsigned int base = 0;
+        const TrMemoryRegion* region = memoryMap.findDownload(memory, addr, base);
+
+        if (region == nullptr) {
+            TR_THROW_EXCEPTION(TrException, "Block at address " + std::to_string((*itr).addr) + " of HEX file can not be read back!");
+        }
+        if ((memory != last) || (base != lastBase)) {
+            // Downloads of flash return whole modulo, downloads of eeprom return lenMax bytes
+            size_t len = (memory == TrMemory::FLASH) ? region->modulo * 2 : region->lenMax;
+            plan.add(TrTransaction(TrOperation::DOWNLOAD, (*itr).target, base, len));
+            last = memory;
+            lastBase = base;
+        }
+    }
+}
+
+TrPlan TrPlanner::plan(TrJob& job) {
+    TrPlan plan;
+    TrJob::hex_iterator itr;
+    std::vector<TrVerifyBlock> deferred;
+
+    if (!job.isParsed()) {
+        job.parse();
+    }
+
+    // TrIfc reads module info once, when the first job is checked
+    plan.add(TrTransaction(TrOperation::MODULE_INFO));
+    plan.add(TrTransaction(TrOperation::ENTER_PRG_MODE));
+
+    if (job.getTrconf()) {
+        std::vector<TrVerifyBlock> written;
+
+        plan.add(TrTransaction(TrOperation::DOWNLOAD, TrTarget::RFBAND, 0, 1));
+        plan.add(TrTransaction(TrOperation::UPLOAD, TrTarget::CFG, 0, CFG_LEN));
+        plan.add(TrTransaction(TrOperation::UPLOAD, TrTarget::RFPMG, 0, RFPMG_LEN));
+
+        written.push_back(TrVerifyBlock(TrTarget::CFG, 0, job.getTrconf()->getData()));
+        written.push_back(TrVerifyBlock(TrTarget::RFPMG, 0, std::basic_string<unsigned char>(1, job.getTrconf()->getRFPMG())));
+        planVerify(written, deferred, plan);
+    }
+
+    for (itr = job.hexBegin(); itr != job.hexEnd(); itr++) {
+        TrMemory memory = (*itr).memory;
+        TrTarget target = getMemoryTarget(memory);
+        HexFmtParser& parser = (*itr).parser;
+        std::vector<TrVerifyBlock> written;
+
+        for (HexFmtParser::iterator block = parser.begin(); block != parser.end(); block++) {
+            // Address in Flash is in 16b words not in bytes
+            unsigned int addr = (memory == TrMemory::FLASH) ? (*block).addr / 2 : (*block).addr;
+            if (memoryMap.check(memory, TrDirection::UPLOAD, addr, (*block).data.length()) != TrMemoryCheck::OK) {
+                TR_THROW_EXCEPTION(TrException, "Block at address " + std::to_string((*block).addr) + " of HEX file does not fit into TR memory!");
+            }
+            plan.add(TrTransaction(TrOperation::UPLOAD, target, addr, ADDR_LEN + (*block).data.length()));
+            written.push_back(TrVerifyBlock(target, (*block).addr, (*block).data));
+        }
+
+        planVerify(written, deferred, plan);
+    }
+
+    if (job.getIqrf()) {
+        IqrfFmtParser& parser = *job.getIqrf();
+        for (IqrfFmtParser::iterator record = parser.begin(); record != parser.end(); record++) {
+            plan.add(TrTransaction(TrOperation::UPLOAD, TrTarget::SPECIAL, 0, (*record).length()));
+        }
+    }
+
+    // Deferred verification reads back all written blocks at once
+    planReadBack(deferred, plan);
+
+    plan.add(TrTransaction(TrOperation::TERMINATE_PRG_MODE));
+
+    return plan;
+}
@@ -0,0 +1,169 @@
+/*
+ * Bus-aware scheduler for programming of multiple TRs.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#include <TrException.h>
+#include <TrScheduler.h>
+
+bool TrCfgUploadTask::step(TrIfc& ifc) {
+    switch (state++) {
+        case 0:
+            parser.parse();
+            parser.checkChannels(ifc.downloadRFBAND());
+            return true;
+        case 1:
+            ifc.uploadCfg(parser.getData());
+            return true;
+        case 2:
+            ifc.uploadRFPMG(parser.getRFPMG());
+            return false;
+        default:
+            return false;
+    }
+}
+
+bool TrHexUploadTask::step(TrIfc& ifc) {
+    if (!parsed) {
+        parser.parse();
+        itr = parser.begin();
+        parsed = true;
+    }
+
+    if (itr == parser.end()) {
+        return false;
+    }
+
+    switch(memory) {
+        case TrMemory::FLASH:
+            ifc.uploadFlash((*itr).addr, (*itr).data);
+            break;
+        case TrMemory::INTERNAL_EEPROM:
+            ifc.uploadInternalEeprom((*itr).addr, (*itr).data);
+            break;
+        case TrMemory::EXTERNAL_EEPROM:
+            ifc.uploadExternalEeprom((*itr).addr, (*itr).data);
+            break;
+        default:
+            TR_THROW_EXCEPTION(TrException, "Invalid TR memory type for HEX file!");
+            break;
+    }
+
+    return ++itr != parser.end();
+}
+
+bool TrIqrfUploadTask::step(TrIfc& ifc) {
+    if (!checked) {
+        parser.parse();
+        ifc.checkIqrf(parser);
+        itr = parser.begin();
+        checked = true;
+        return itr != parser.end();
+    }
+
+    if (itr == parser.end()) {
+        return false;
+    }
+
+    ifc.uploadSpecial(*itr);
+
+    return ++itr != parser.end();
+}
+
+size_t TrScheduler::addDevice(std::string bus, TrIfc* ifc) {
+    devices.push_back(Device(bus, ifc));
+    return devices.size() - 1;
+}
+
+void TrScheduler::addTask(size_t device, std::shared_ptr<TrTask> task) {
+    devices.at(device).tasks.push_back(task);
+}
+
+void TrScheduler::fail(Device& device, const std::string& error) {
+    device.error = error.empty() ? "Unknown error!" : error;
+    try {
+        device.ifc->terminateProgrammingMode();
+    } catch (...) {
+        // Device has already failed, keep the first error
+    }
+}
+
+// Performs one transfer on the device, returns false when the device is done
+bool TrScheduler::step(Device& device) {
+    try {
+        if (!device.started) {
+            device.ifc->enterProgrammingMode();
+            device.started = true;
+            return true;
+        }
+
+        if (!device.tasks.empty()) {
+            if (!device.tasks.front()->step(*device.ifc)) {
+                device.tasks.pop_front();
+            }
+            return true;
+        }
+
+        device.ifc->terminateProgrammingMode();
+    } catch (std::exception& e) {
+        fail(device, e.what());
+    } catch (...) {
+        // Exception of a channel must not stop the other devices
+        fail(device, "");
+    }
+
+    device.finished = true;
+    return false;
+}
+
+// Interleaves devices on one bus block by block in round robin order
+void TrScheduler::runBus(std::vector<Device*> bus) {
+    size_t active = bus.size();
+
+    while (active > 0) {
+        for (std::vector<Device*>::iterator itr = bus.begin(); itr != bus.end(); itr++) {
+            if (!(*itr)->finished && !step(**itr)) {
+                active--;
+            }
+        }
+    }
+}
+
+bool TrScheduler::run() {
+    std::vector<std::string> names;
+    std::vector<std::vector<Device*>> buses;
+    std::vector<std::thread> threads;
+
+    for (std::vector<Device>::iterator itr = devices.begin(); itr != devices.end(); itr++) {
+        size_t idx = std::distance(names.begin(), std::find(names.begin(), names.end(), (*itr).bus));
+        if (idx == names.size()) {
+            names.push_back((*itr).bus);
+            buses.push_back(std::vector<Device*>());
+        }
+        (*itr).started = false;
+        (*itr).finished = false;
+        (*itr).error.clear();
+        buses[idx].push_back(&(*itr));
+    }
+
+    // The calling thread serves the first bus, others get their own thread
+    for (size_t i = 1; i < buses.size(); i++) {
+        threads.push_back(std::thread(&TrScheduler::runBus, this, buses[i]));
+    }
+
+    if (!buses.empty()) {
+        runBus(buses[0]);
+    }
+
+    for (std::vector<std::thread>::iterator itr = threads.begin(); itr != threads.end(); itr++) {
+        (*itr).join();
+    }
+
+    return std::none_of(devices.begin(), devices.end(), [](const Device& d){return !d.error.empty();});
+}
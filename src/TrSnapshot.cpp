@@ -0,0 +1,213 @@
+/*
+ * Snapshot of whole TR memory in a single binary container.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <TrException.h>
+#include <TrSnapshot.h>
+#include <TrFill.h>
+#include "binary_operations.h"
+
+static const char SNAPSHOT_MAGIC[4]     = {'T', 'R', 'S', 'N'};
+static const size_t SNAPSHOT_HEADER_LEN = 16;
+static const size_t REGION_HEADER_LEN   = 32;
+// Region header of version 1 without fill elision
+static const size_t REGION_HEADER_LEN_1 = 24;
+static const unsigned char REGION_ELIDED = 0x01;
+
+TrSnapshotWriter::TrSnapshotWriter(std::string name, const TrModuleInfo& info)
+    : file_name(name), file(name, std::ios::out | std::ios::binary | std::ios::trunc), regions(0), regionLen(0), blocks(0) {
+    unsigned char header[SNAPSHOT_HEADER_LEN] = {0};
+
+    std::copy_n(SNAPSHOT_MAGIC, 4, header);
+    header[4] = TR_SNAPSHOT_VERSION;
+    header[5] = static_cast<unsigned char>(info.mcu);
+    header[6] = static_cast<unsigned char>(info.serie);
+    header[7] = info.osVersion;
+    putValue(header + 8, info.osBuild, 2);
+    // Number of regions is written by close
+    write(header, SNAPSHOT_HEADER_LEN);
+}
+
+void TrSnapshotWriter::write(const unsigned char* data, size_t len) {
+    if (!file.write(reinterpret_cast<const char*>(data), len)) {
+        TR_THROW_EXCEPTION(TrException, "Can not write snapshot " + file_name + "!");
+    }
+}
+
+void TrSnapshotWriter::beginRegion(TrTarget target, unsigned int addr, unsigned int step, bool elide, uint16_t fill) {
+    unsigned char header[REGION_HEADER_LEN] = {0};
+
+    region = TrSnapshotRegion();
+    region.target = target;
+    region.addr = addr;
+    region.step = step;
+    region.elide = elide;
+    region.fill = fill;
+    regionLen = 0;
+    blocks = 0;
+    stored.clear();
+    hash = TrHash();
+
+    // Region header is completed by endRegion
+    regionPos = file.tellp();
+    write(header, REGION_HEADER_LEN);
+}
+
+void TrSnapshotWriter::writeBlock(const std::basic_string<unsigned char>& data) {
+    if (region.blockLen == 0) {
+        region.blockLen = data.length();
+    }
+
+    if (data.length() != region.blockLen) {
+        TR_THROW_EXCEPTION(TrException, "Downloaded blocks of one region must have the same length!");
+    }
+
+    if (blocks % 8 == 0) {
+        stored += static_cast<unsigned char>(0);
+    }
+
+    hash.update(data);
+    if (!region.elide || !isTrFillBlock(data.data(), data.length(), region.fill)) {
+        write(data.data(), data.length());
+        regionLen += data.length();
+        stored[blocks / 8] |= 1 << (blocks % 8);
+    }
+    blocks++;
+}
+
+void TrSnapshotWriter::endRegion() {
+    unsigned char header[REGION_HEADER_LEN] = {0};
+    std::streampos end;
+
+    // Bitmap of stored blocks follows the data
+    if (region.elide) {
+        write(stored.data(), stored.length());
+    }
+    end = file.tellp();
+
+    header[0] = static_cast<unsigned char>(region.target);
+    header[1] = region.elide ? REGION_ELIDED : 0;
+    putValue(header + 2, region.blockLen, 2);
+    putValue(header + 4, region.addr, 4);
+    putValue(header + 8, region.step, 4);
+    putValue(header + 12, regionLen, 4);
+    putValue(header + 16, hash.digest(), 8);
+    putValue(header + 24, blocks, 4);
+    putValue(header + 28, region.fill, 2);
+
+    file.seekp(regionPos);
+    write(header, REGION_HEADER_LEN);
+    file.seekp(end);
+    regions++;
+}
+
+void TrSnapshotWriter::close() {
+    unsigned char count[4];
+
+    putValue(count, regions, 4);
+    file.seekp(12);
+    write(count, 4);
+    file.close();
+
+    if (file.fail()) {
+        TR_THROW_EXCEPTION(TrException, "Can not write snapshot " + file_name + "!");
+    }
+}
+
+void TrSnapshot::load(std::string name) {
+    std::ifstream infile(name, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+    const unsigned char* buffer = reinterpret_cast<const unsigned char*>(content.data());
+    size_t pos = SNAPSHOT_HEADER_LEN;
+    size_t count;
+
+    if ((content.length() < SNAPSHOT_HEADER_LEN) || !std::equal(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 4, content.begin())) {
+        TR_THROW_EXCEPTION(TrException, "File " + name + " is not a TR snapshot!");
+    }
+
+    if ((buffer[4] == 0) || (buffer[4] > TR_SNAPSHOT_VERSION)) {
+        TR_THROW_EXCEPTION(TrException, "Unsupported version " + std::to_string(buffer[4]) + " of snapshot " + name + "!");
+    }
+
+    info.mcu = static_cast<TrMcu>(buffer[5]);
+    info.serie = static_cast<TrSerie>(buffer[6]);
+    info.osVersion = buffer[7];
+    info.osBuild = getValue(buffer + 8, 2);
+    // Snapshot is not bound to the module it was taken from
+    info.serial = 0;
+    count = getValue(buffer + 12, 4);
+
+    regions.clear();
+    for (size_t i = 0; i < count; i++) {
+        TrSnapshotRegion region;
+        TrHash hash;
+        size_t header = (buffer[4] == 1) ? REGION_HEADER_LEN_1 : REGION_HEADER_LEN;
+        size_t len;
+        size_t blocks = 0;
+        const unsigned char* data;
+        const unsigned char* stored;
+
+        if (pos + header > content.length()) {
+            TR_THROW_EXCEPTION(TrException, "Snapshot " + name + " is truncated!");
+        }
+
+        region.target = static_cast<TrTarget>(buffer[pos]);
+        region.blockLen = getValue(buffer + pos + 2, 2);
+        region.addr = getValue(buffer + pos + 4, 4);
+        region.step = getValue(buffer + pos + 8, 4);
+        len = getValue(buffer + pos + 12, 4);
+        region.hash = getValue(buffer + pos + 16, 8);
+        if (header == REGION_HEADER_LEN) {
+            region.elide = (buffer[pos + 1] & REGION_ELIDED) != 0;
+            blocks = getValue(buffer + pos + 24, 4);
+            region.fill = getValue(buffer + pos + 28, 2);
+        }
+        pos += header;
+
+        if ((pos + len > content.length()) || ((region.blockLen != 0) && (len % region.blockLen != 0))) {
+            TR_THROW_EXCEPTION(TrException, "Snapshot " + name + " is truncated!");
+        }
+        data = buffer + pos;
+        pos += len;
+
+        if (!region.elide) {
+            region.data.assign(data, len);
+        } else {
+            // Rematerialize fill blocks
+            std::basic_string<unsigned char> fill;
+            for (size_t j = 0; j < region.blockLen; j++) {
+                fill += (j % 2) ? (region.fill >> 8) : (region.fill & 0xff);
+            }
+            stored = buffer + pos;
+            pos += (blocks + 7) / 8;
+            if (pos > content.length()) {
+                TR_THROW_EXCEPTION(TrException, "Snapshot " + name + " is truncated!");
+            }
+            for (size_t j = 0; j < blocks; j++) {
+                if (stored[j / 8] & (1 << (j % 8))) {
+                    if (data + region.blockLen > stored) {
+                        TR_THROW_EXCEPTION(TrException, "Snapshot " + name + " is damaged!");
+                    }
+                    region.data.append(data, region.blockLen);
+                    data += region.blockLen;
+                } else {
+                    region.data += fill;
+                }
+            }
+        }
+
+        hash.update(region.data);
+        if (hash.digest() != region.hash) {
+            TR_THROW_EXCEPTION(TrException, "Hash of region " + std::to_string(i) + " of snapshot " + name + " does not match its content!");
+        }
+
+        regions.push_back(region);
+    }
+}
@@ -0,0 +1,391 @@
+/*
+ * Deduplicating store of TR snapshots.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include <TrException.h>
+#include <TrSnapshotStore.h>
+#include "binary_operations.h"
+
+static const char PACK_MAGIC[4]         = {'T', 'R', 'B', 'P'};
+static const char MANIFEST_MAGIC[4]     = {'T', 'R', 'S', 'M'};
+static const unsigned char STORE_VERSION = 1;
+static const size_t PACK_HEADER_LEN     = 8;
+static const size_t MANIFEST_HEADER_LEN = 20;
+static const size_t REGION_HEADER_LEN   = 24;
+static const size_t MANIFEST_RUN_LEN    = 12;
+
+static std::string readFile(const std::string& name) {
+    std::ifstream infile(name, std::ios::binary);
+
+    return std::string((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+}
+
+TrSnapshotStore::TrSnapshotStore(std::string directory) : dir(directory) {
+    std::string name = dir + "/blocks.trbp";
+    std::string content = readFile(name);
+    const unsigned char* buffer = reinterpret_cast<const unsigned char*>(content.data());
+    size_t pos = PACK_HEADER_LEN;
+
+    if (content.empty()) {
+        unsigned char header[PACK_HEADER_LEN] = {0};
+        std::copy_n(PACK_MAGIC, 4, header);
+        header[4] = STORE_VERSION;
+        pack.assign(header, PACK_HEADER_LEN);
+    } else {
+        if ((content.length() < PACK_HEADER_LEN) || !std::equal(PACK_MAGIC, PACK_MAGIC + 4, content.begin()) ||
+            (buffer[4] != STORE_VERSION)) {
+            TR_THROW_EXCEPTION(TrException, "File " + name + " is not a pack of TR snapshot store!");
+        }
+
+        // Blocks are compared to previous ones, the pack must be in place
+        pack.assign(buffer, content.length());
+        while (pos + 2 <= content.length()) {
+            size_t len = getValue(buffer + pos, 2);
+            bool found = false;
+
+            if (pos + 2 + len > content.length()) {
+                break;
+            }
+            uint64_t key = findKey(buffer + pos + 2, len, found);
+            if (!found) {
+                index[key] = pos + 2;
+            }
+            pos += 2 + len;
+        }
+        pack.resize(pos);
+    }
+
+    // Block cut by interrupted write is dropped, manifests are written after their blocks
+    if (pack.length() != content.length()) {
+        packFile.open(name, std::ios::out | std::ios::binary | std::ios::trunc);
+        packFile.write(reinterpret_cast<const char*>(pack.data()), pack.length());
+    } else {
+        packFile.open(name, std::ios::out | std::ios::binary | std::ios::app);
+    }
+
+    if (!packFile) {
+        TR_THROW_EXCEPTION(TrException, "Can not open pack " + name + "!");
+    }
+}
+
+std::string TrSnapshotStore::getManifestName(const std::string& name) const {
+    return dir + "/" + name + ".trsm";
+}
+
+uint64_t TrSnapshotStore::findKey(const unsigned char* data, size_t len, bool& found) const {
+    std::unordered_map<uint64_t, size_t>::const_iterator itr;
+    TrHash hash;
+    uint64_t key;
+
+    hash.update(data, len);
+    for (key = hash.digest(); (itr = index.find(key)) != index.end(); key++) {
+        if ((getValue(pack.data() + (*itr).second - 2, 2) == len) &&
+            (std::memcmp(pack.data() + (*itr).second, data, len) == 0)) {
+            found = true;
+            return key;
+        }
+    }
+
+    found = false;
+    return key;
+}
+
+uint64_t TrSnapshotStore::putBlock(const std::basic_string<unsigned char>& data) {
+    unsigned char len[2];
+    bool found = false;
+    uint64_t key = findKey(data.data(), data.length(), found);
+
+    if (found) {
+        return key;
+    }
+
+    if (data.length() > 0xffff) {
+        TR_THROW_EXCEPTION(TrException, "Block of " + std::to_string(data.length()) + "B can not be stored in snapshot store!");
+    }
+
+    putValue(len, data.length(), 2);
+    pack.append(len, 2);
+    index[key] = pack.length();
+    pack.append(data);
+
+    if (!packFile.write(reinterpret_cast<const char*>(len), 2) ||
+        !packFile.write(reinterpret_cast<const char*>(data.data()), data.length())) {
+        TR_THROW_EXCEPTION(TrException, "Can not write pack of snapshot store " + dir + "!");
+    }
+
+    return key;
+}
+
+void TrSnapshotStore::flush() {
+    if (!packFile.flush()) {
+        TR_THROW_EXCEPTION(TrException, "Can not write pack of snapshot store " + dir + "!");
+    }
+}
+
+void TrSnapshotStore::putManifest(std::string name, const TrManifest& manifest) {
+    std::vector<TrManifestRegion>::const_iterator itr;
+    std::basic_string<unsigned char> content(MANIFEST_HEADER_LEN, 0);
+    std::string file_name = getManifestName(name);
+    std::string temp_name = file_name + ".tmp";
+
+    std::copy_n(MANIFEST_MAGIC, 4, content.begin());
+    content[4] = STORE_VERSION;
+    content[5] = static_cast<unsigned char>(manifest.info.mcu);
+    content[6] = static_cast<unsigned char>(manifest.info.serie);
+    content[7] = manifest.info.osVersion;
+    putValue(&content[8], manifest.info.osBuild, 2);
+    putValue(&content[12], manifest.regions.size(), 4);
+    putValue(&content[16], manifest.info.serial, 4);
+
+    for (itr = manifest.regions.begin(); itr != manifest.regions.end(); itr++) {
+        unsigned char header[REGION_HEADER_LEN] = {0};
+        header[0] = static_cast<unsigned char>((*itr).target);
+        putValue(header + 2, (*itr).blockLen, 2);
+        putValue(header + 4, (*itr).addr, 4);
+        putValue(header + 8, (*itr).step, 4);
+        putValue(header + 12, (*itr).blocks.size(), 4);
+        putValue(header + 16, (*itr).hash, 8);
+        content.append(header, REGION_HEADER_LEN);
+
+        // Runs of the same block, mostly erased memory, are stored once
+        for (size_t i = 0; i < (*itr).blocks.size(); ) {
+            unsigned char run[MANIFEST_RUN_LEN];
+            size_t len = 1;
+            while ((i + len < (*itr).blocks.size()) && ((*itr).blocks[i + len] == (*itr).blocks[i])) {
+                len++;
+            }
+            putValue(run, (*itr).blocks[i], 8);
+            putValue(run + 8, len, 4);
+            content.append(run, MANIFEST_RUN_LEN);
+            i += len;
+        }
+    }
+
+    // Blocks must be in the pack before any manifest references them
+    flush();
+
+    std::ofstream outfile(temp_name, std::ios::binary | std::ios::trunc);
+    if (!outfile.write(reinterpret_cast<const char*>(content.data()), content.length()) || !outfile.flush()) {
+        TR_THROW_EXCEPTION(TrException, "Can not write manifest " + temp_name + "!");
+    }
+    outfile.close();
+
+    if (std::rename(temp_name.c_str(), file_name.c_str()) != 0) {
+        TR_THROW_EXCEPTION(TrException, "Can not replace manifest " + file_name + "!");
+    }
+}
+
+void TrSnapshotStore::getManifest(std::string name, TrManifest& manifest) const {
+    std::string file_name = getManifestName(name);
+    std::string content = readFile(file_name);
+    const unsigned char* buffer = reinterpret_cast<const unsigned char*>(content.data());
+    size_t pos = MANIFEST_HEADER_LEN;
+    size_t count;
+
+    if ((content.length() < MANIFEST_HEADER_LEN) || !std::equal(MANIFEST_MAGIC, MANIFEST_MAGIC + 4, content.begin())) {
+        TR_THROW_EXCEPTION(TrException, "File " + file_name + " is not a manifest of TR snapshot!");
+    }
+
+    if (buffer[4] != STORE_VERSION) {
+        TR_THROW_EXCEPTION(TrException, "Unsupported version " + std::to_string(buffer[4]) + " of manifest " + file_name + "!");
+    }
+
+    manifest.info.mcu = static_cast<TrMcu>(buffer[5]);
+    manifest.info.serie = static_cast<TrSerie>(buffer[6]);
+    manifest.info.osVersion = buffer[7];
+    manifest.info.osBuild = getValue(buffer + 8, 2);
+    manifest.info.serial = getValue(buffer + 16, 4);
+    count = getValue(buffer + 12, 4);
+
+    manifest.regions.clear();
+    for (size_t i = 0; i < count; i++) {
+        TrManifestRegion region;
+        size_t blocks;
+
+        if (pos + REGION_HEADER_LEN > content.length()) {
+            TR_THROW_EXCEPTION(TrException, "Manifest " + file_name + " is truncated!");
+        }
+
+        region.target = static_cast<TrTarget>(buffer[pos]);
+        region.blockLen = getValue(buffer + pos + 2, 2);
+        region.addr = getValue(buffer + pos + 4, 4);
+        region.step = getValue(buffer + pos + 8, 4);
+        blocks = getValue(buffer + pos + 12, 4);
+        region.hash = getValue(buffer + pos + 16, 8);
+        pos += REGION_HEADER_LEN;
+
+        while (region.blocks.size() < blocks) {
+            size_t len;
+
+            if (pos + MANIFEST_RUN_LEN > content.length()) {
+                TR_THROW_EXCEPTION(TrException, "Manifest " + file_name + " is truncated!");
+            }
+            len = getValue(buffer + pos + 8, 4);
+            if ((len == 0) || (region.blocks.size() + len > blocks)) {
+                TR_THROW_EXCEPTION(TrException, "Manifest " + file_name + " is damaged!");
+            }
+            region.blocks.insert(region.blocks.end(), len, getValue(buffer + pos, 8));
+            pos += MANIFEST_RUN_LEN;
+        }
+
+        manifest.regions.push_back(region);
+    }
+}
+
+void TrSnapshotStore::put(std::string name, const TrSnapshot& snapshot) {
+    TrSnapshot::const_iterator itr;
+    TrManifest manifest;
+
+    manifest.info = snapshot.getModuleInfo();
+    for (itr = snapshot.begin(); itr != snapshot.end(); itr++) {
+        TrManifestRegion region;
+        region.target = (*itr).target;
+        region.addr = (*itr).addr;
+        region.step = (*itr).step;
+        region.blockLen = (*itr).blockLen;
+        region.hash = (*itr).hash;
+
+        for (size_t i = 0; i < (*itr).getBlockCount(); i++) {
+            region.blocks.push_back(putBlock((*itr).data.substr(i * (*itr).blockLen, (*itr).blockLen)));
+        }
+
+        manifest.regions.push_back(region);
+    }
+
+    putManifest(name, manifest);
+}
+
+void TrSnapshotStore::get(std::string name, TrSnapshot& snapshot) const {
+    std::vector<TrManifestRegion>::const_iterator itr;
+    TrManifest manifest;
+
+    getManifest(name, manifest);
+
+    snapshot.info = manifest.info;
+    snapshot.regions.clear();
+    for (itr = manifest.regions.begin(); itr != manifest.regions.end(); itr++) {
+        TrSnapshotRegion region;
+        TrHash hash;
+
+        region.target = (*itr).target;
+        region.addr = (*itr).addr;
+        region.step = (*itr).step;
+        region.blockLen = (*itr).blockLen;
+        region.hash = (*itr).hash;
+        region.data.reserve((*itr).blocks.size() * (*itr).blockLen);
+
+        for (size_t i = 0; i < (*itr).blocks.size(); i++) {
+            std::unordered_map<uint64_t, size_t>::const_iterator block = index.find((*itr).blocks[i]);
+            if ((block == index.end()) || (getValue(pack.data() + (*block).second - 2, 2) != region.blockLen)) {
+                TR_THROW_EXCEPTION(TrException, "Block " + std::to_string(i) + " of snapshot " + name + " is missing in the store!");
+            }
+            region.data.append(pack.data() + (*block).second, region.blockLen);
+        }
+
+        hash.update(region.data);
+        if (hash.digest() != region.hash) {
+            TR_THROW_EXCEPTION(TrException, "Hash of region " + std::to_string(snapshot.regions.size()) + " of snapshot " + name + " does not match its content!");
+        }
+
+        snapshot.regions.push_back(region);
+    }
+}
+
+// All blocks of region without counterpart differ
+static void addChanges(const TrManifestRegion& region, size_t first, std::vector<TrSnapshotChange>& changes) {
+    for (size_t i = first; i < region.blocks.size(); i++) {
+        changes.push_back(TrSnapshotChange(region.target, region.addr + i * region.step));
+    }
+}
+
+void TrSnapshotStore::diff(std::string a, std::string b, std::vector<TrSnapshotChange>& changes) const {
+    typedef std::tuple<TrTarget, unsigned int, unsigned int, size_t> RegionKey;
+    std::map<RegionKey, const TrManifestRegion*> regions;
+    std::map<RegionKey, const TrManifestRegion*>::iterator found;
+    std::vector<TrManifestRegion>::const_iterator itr;
+    TrManifest first;
+    TrManifest second;
+
+    getManifest(a, first);
+    getManifest(b, second);
+    changes.clear();
+
+    for (itr = second.regions.begin(); itr != second.regions.end(); itr++) {
+        regions[std::make_tuple((*itr).target, (*itr).addr, (*itr).step, (*itr).blockLen)] = &(*itr);
+    }
+
+    for (itr = first.regions.begin(); itr != first.regions.end(); itr++) {
+        found = regions.find(std::make_tuple((*itr).target, (*itr).addr, (*itr).step, (*itr).blockLen));
+        if (found == regions.end()) {
+            addChanges(*itr, 0, changes);
+            continue;
+        }
+
+        const TrManifestRegion& other = *(*found).second;
+        size_t common = std::min((*itr).blocks.size(), other.blocks.size());
+        // Same regions are skipped without comparing blocks
+        if ((*itr).hash != other.hash) {
+            for (size_t i = 0; i < common; i++) {
+                if ((*itr).blocks[i] != other.blocks[i]) {
+                    changes.push_back(TrSnapshotChange((*itr).target, (*itr).addr + i * (*itr).step));
+                }
+            }
+        }
+        addChanges(*itr, common, changes);
+        addChanges(other, common, changes);
+        regions.erase(found);
+    }
+
+    for (found = regions.begin(); found != regions.end(); found++) {
+        addChanges(*(*found).second, 0, changes);
+    }
+}
+
+TrSnapshotStoreWriter::TrSnapshotStoreWriter(TrSnapshotStore& s, std::string n, const TrModuleInfo& info) : store(s), name(n) {
+    manifest.info = info;
+}
+
+void TrSnapshotStoreWriter::beginRegion(TrTarget target, unsigned int addr, unsigned int step, bool, uint16_t) {
+    TrManifestRegion region;
+
+    region.target = target;
+    region.addr = addr;
+    region.step = step;
+    manifest.regions.push_back(region);
+    hash = TrHash();
+}
+
+void TrSnapshotStoreWriter::writeBlock(const std::basic_string<unsigned char>& data) {
+    TrManifestRegion& region = manifest.regions.back();
+
+    if (region.blockLen == 0) {
+        region.blockLen = data.length();
+    }
+
+    if (data.length() != region.blockLen) {
+        TR_THROW_EXCEPTION(TrException, "Downloaded blocks of one region must have the same length!");
+    }
+
+    hash.update(data);
+    region.blocks.push_back(store.putBlock(data));
+}
+
+void TrSnapshotStoreWriter::endRegion() {
+    manifest.regions.back().hash = hash.digest();
+}
+
+void TrSnapshotStoreWriter::close() {
+    store.putManifest(name, manifest);
+}
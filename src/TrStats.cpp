@@ -0,0 +1,87 @@
+/*
+ * Transfer statistics of TR interface.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <TrStats.h>
+
+void TrHistogram::reset() {
+    buckets.fill(0);
+    cnt = 0;
+    sum = 0;
+    minValue = UINT32_MAX;
+    maxValue = 0;
+}
+
+size_t TrHistogram::getIndex(uint32_t value) {
+    unsigned int msb = 0;
+
+    if (value < 2 * SUB_COUNT) {
+        return value;
+    }
+
+    for (uint32_t v = value; v > 1; v >>= 1) {
+        msb++;
+    }
+
+    unsigned int shift = msb - SUB_BITS;
+    return (shift + 1) * SUB_COUNT + ((value >> shift) - SUB_COUNT);
+}
+
+uint32_t TrHistogram::getValue(size_t index) {
+    if (index < 2 * SUB_COUNT) {
+        return index;
+    }
+
+    unsigned int shift = index / SUB_COUNT - 1;
+    return static_cast<uint32_t>(index % SUB_COUNT + SUB_COUNT) << shift;
+}
+
+void TrHistogram::record(uint32_t value) {
+    buckets[getIndex(value)]++;
+    cnt++;
+    sum += value;
+    if (value < minValue) {
+        minValue = value;
+    }
+    if (value > maxValue) {
+        maxValue = value;
+    }
+}
+
+uint32_t TrHistogram::percentile(double p) const {
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * cnt + 0.5);
+    uint64_t seen = 0;
+
+    if (cnt == 0) {
+        return 0;
+    }
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return getValue(i);
+        }
+    }
+    return maxValue;
+}
+
+void TrStats::recordUpload(unsigned char target, size_t len, uint32_t us) {
+    TrTargetStats& stats = targets.at(target);
+
+    stats.uploads++;
+    stats.uploadBytes += len;
+    stats.latency.record(us);
+}
+
+void TrStats::recordDownload(unsigned char target, size_t len, uint32_t us) {
+    TrTargetStats& stats = targets.at(target);
+
+    stats.downloads++;
+    stats.downloadBytes += len;
+    stats.latency.record(us);
+}
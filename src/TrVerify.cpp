@@ -0,0 +1,20 @@
+/*
+ * Read back verification of programmed TR memory.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <TrHash.h>
+#include <TrVerify.h>
+
+bool isTrBlockSampled(TrTarget target, unsigned int addr, unsigned int percent) {
+    TrHash hash;
+
+    if (percent >= 100) {
+        return true;
+    }
+
+    hash.update(static_cast<unsigned int>(target));
+    hash.update(addr);
+    return (hash.digest() % 100) < percent;
+}
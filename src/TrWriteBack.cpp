@@ -0,0 +1,85 @@
+/*
+ * Write back buffer of small eeprom writes.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include <TrException.h>
+#include <TrWriteBack.h>
+
+TrWriteBack::Runs& TrWriteBack::getRuns(TrMemory memory) {
+    switch(memory) {
+        case TrMemory::INTERNAL_EEPROM:
+            return internal;
+        case TrMemory::EXTERNAL_EEPROM:
+            return external;
+        default:
+            TR_THROW_EXCEPTION(TrException, "Only eeprom writes can be buffered!");
+            break;
+    }
+}
+
+const TrWriteBack::Runs& TrWriteBack::getRuns(TrMemory memory) const {
+    return const_cast<TrWriteBack*>(this)->getRuns(memory);
+}
+
+void TrWriteBack::add(TrMemory memory, unsigned int addr, const std::basic_string<unsigned char>& data) {
+    Runs& runs = getRuns(memory);
+    Runs::iterator first = runs.lower_bound(addr);
+    Runs::iterator itr;
+    unsigned int end = addr + data.length();
+    unsigned int start = addr;
+    unsigned int stop = end;
+    std::basic_string<unsigned char> merged;
+
+    if (data.empty()) {
+        return;
+    }
+
+    // Run before the address is merged if it reaches the address
+    if (first != runs.begin()) {
+        Runs::iterator prev = std::prev(first);
+        if ((*prev).first + (*prev).second.length() >= addr) {
+            first = prev;
+        }
+    }
+
+    for (itr = first; (itr != runs.end()) && ((*itr).first <= end); itr++) {
+        start = std::min(start, (*itr).first);
+        stop = std::max(stop, static_cast<unsigned int>((*itr).first + (*itr).second.length()));
+    }
+
+    merged.resize(stop - start);
+    for (itr = first; (itr != runs.end()) && ((*itr).first <= end); ) {
+        std::copy((*itr).second.begin(), (*itr).second.end(), merged.begin() + ((*itr).first - start));
+        itr = runs.erase(itr);
+    }
+    std::copy(data.begin(), data.end(), merged.begin() + (addr - start));
+
+    runs[start] = merged;
+}
+
+size_t TrWriteBack::overlay(TrMemory memory, unsigned int addr, std::basic_string<unsigned char>& block) const {
+    const Runs& runs = getRuns(memory);
+    Runs::const_iterator itr = runs.upper_bound(addr);
+    unsigned int end = addr + block.length();
+    size_t copied = 0;
+
+    if (itr != runs.begin()) {
+        itr--;
+    }
+
+    for (; (itr != runs.end()) && ((*itr).first < end); itr++) {
+        unsigned int from = std::max(addr, (*itr).first);
+        unsigned int to = std::min(end, static_cast<unsigned int>((*itr).first + (*itr).second.length()));
+        for (unsigned int i = from; i < to; i++) {
+            block[i - addr] = (*itr).second[i - (*itr).first];
+            copied++;
+        }
+    }
+
+    return copied;
+}
@@ -11,9 +11,9 @@
 
 #include "TrconfFmtParser.h"
 #include "TrFmtException.h"
+#include "tr_protocol.h"
 
 const size_t CFG_FILE_LEN = 33;
-const size_t CFG_LEN = 32;
 
 const size_t CFG_SUBNET_CHANNEL_A = 0x06;
 const size_t CFG_SUBNET_CHANNEL_B = 0x07;
@@ -61,29 +61,55 @@ static bool checkChannel(unsigned char rfband, unsigned char channel) {
             return true;
             break;
         default:
-            TR_THROW_EXCEPTION(TrException, "Invalid RF band received from TR!");
+            return false;
             break;
     }
 }
 
+static bool checkRfBand(unsigned char rfband) {
+    switch (rfband & RFBAND_MASK) {
+        case RF_433:
+        case RF_868:
+        case RF_916:
+            return true;
+        default:
+            return false;
+    }
+}
+
 void TrconfFmtParser::checkChannels(unsigned char rfband) {
     if (!parsed)
         parse();
     
-    if (!checkChannel(rfband, data[CFG_SUBNET_CHANNEL_A])) {
-        TR_THROW_FMT_EXCEPTION(file_name, 1, 0, "Invalid main RF channel A of the optional subordinate network for configured RFBAND!");
+    checkChannels(rfband, data, file_name);
+}
+
+TrError TrconfFmtParser::validateChannels(unsigned char rfband, const std::basic_string<unsigned char>& data) {
+    // Order of channels matches TrErrorCode::INVALID_CHANNEL argument
+    static const size_t channels[] = {CFG_SUBNET_CHANNEL_A, CFG_SUBNET_CHANNEL_B, CFG_MAINNET_CHANNEL_A, CFG_MAINNET_CHANNEL_B};
+    
+    if (!checkRfBand(rfband)) {
+        return TrError(TrErrorCode::INVALID_RFBAND, TR_ERROR_LOCATION);
     }
     
-    if (!checkChannel(rfband, data[CFG_SUBNET_CHANNEL_B])) {
-        TR_THROW_FMT_EXCEPTION(file_name, 1, 0, "Invalid main RF channel B of the optional subordinate network for configured RFBAND!");
+    for (unsigned int i = 0; i < sizeof(channels) / sizeof(channels[0]); i++) {
+        if (!checkChannel(rfband, data[channels[i]])) {
+            return TrError(TrErrorCode::INVALID_CHANNEL, TR_ERROR_LOCATION, i);
+        }
     }
     
-    if (!checkChannel(rfband, data[CFG_MAINNET_CHANNEL_A])) {
-        TR_THROW_FMT_EXCEPTION(file_name, 1, 0, "Invalid main RF channel A of the main network for configured RFBAND!");
+    return TrError();
+}
+
+void TrconfFmtParser::checkChannels(unsigned char rfband, const std::basic_string<unsigned char>& data, const std::string& file_name) {
+    TrError error = validateChannels(rfband, data);
+    
+    if (error.getCode() == TrErrorCode::INVALID_RFBAND) {
+        error.raise();
     }
     
-    if (!checkChannel(rfband, data[CFG_MAINNET_CHANNEL_B])) {
-        TR_THROW_FMT_EXCEPTION(file_name, 1, 0, "Invalid main RF channel B of the main network for configured RFBAND!");
+    if (!error.isOk()) {
+        TR_THROW_FMT_EXCEPTION(file_name, 1, 0, error.getMessage());
     }
 }
 
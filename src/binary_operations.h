@@ -0,0 +1,37 @@
+/*
+ * Little endian values of binary file formats.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __BINARY_OPERATIONS_H__
+#define __BINARY_OPERATIONS_H__
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Store len lowest bytes of value
+inline void putValue(unsigned char* buffer, uint64_t value, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        buffer[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+inline uint64_t getValue(const unsigned char* buffer, size_t len) {
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        value |= static_cast<uint64_t>(buffer[i]) << (8 * i);
+    }
+    return value;
+}
+
+inline void appendValue(std::basic_string<unsigned char>& content, uint64_t value, size_t len) {
+    unsigned char buffer[8];
+
+    putValue(buffer, value, len);
+    content.append(buffer, len);
+}
+
+#endif // __BINARY_OPERATIONS_H__
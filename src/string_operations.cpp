@@ -5,35 +5,131 @@
  */
 
 #include <string>
-#include <vector>
+#include <cstring>
+#include <cstdint>
 #include "string_operations.h"
 
-std::string trim(const std::string& str, const std::string& whitespace) {
+// Set of characters as bitmap, lookup does not scan the characters
+class char_set {
+private:
+    uint64_t bits[4];
+public:
+    char_set(const char* chars) : bits{0, 0, 0, 0} {
+        for (const unsigned char* c = reinterpret_cast<const unsigned char*>(chars); *c != '\0'; c++) {
+            bits[*c >> 6] |= static_cast<uint64_t>(1) << (*c & 0x3f);
+        }
+    }
+    bool contains(char c) const {
+        unsigned char u = static_cast<unsigned char>(c);
+        return (bits[u >> 6] >> (u & 0x3f)) & 1;
+    }
+};
+
+static int hex_digit(char c) {
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+    return -1;
+}
+
+string_span string_span::substr(size_t pos, size_t count) const {
+    if (pos > len)
+        pos = len;
+    if (count > len - pos)
+        count = len - pos;
+    return string_span(ptr + pos, count);
+}
+
+size_t string_span::find_first_of(const char* chars, size_t pos) const {
+    char_set set(chars);
+
+    for (size_t i = pos; i < len; i++) {
+        if (set.contains(ptr[i]))
+            return i;
+    }
+    return npos;
+}
+
+size_t string_span::find_first_not_of(const char* chars, size_t pos) const {
+    char_set set(chars);
+
+    for (size_t i = pos; i < len; i++) {
+        if (!set.contains(ptr[i]))
+            return i;
+    }
+    return npos;
+}
+
+size_t string_span::find_last_not_of(const char* chars) const {
+    char_set set(chars);
+
+    for (size_t i = len; i > 0; i--) {
+        if (!set.contains(ptr[i - 1]))
+            return i - 1;
+    }
+    return npos;
+}
+
+string_span trim(string_span str, const char* whitespace) {
     size_t start = str.find_first_not_of(whitespace);
-    if (start == std::string::npos)
-        return "";
+    if (start == string_span::npos)
+        return string_span();
     size_t stop = str.find_last_not_of(whitespace);
 
     return str.substr(start, stop - start + 1);
 }
 
-std::string uncomment(const std::string& str) {
-    size_t pos = str.find_first_of('#');
-    if (pos == std::string::npos)
+string_span uncomment(string_span str) {
+    size_t pos = str.find_first_of("#");
+    if (pos == string_span::npos)
         return str;
     return str.substr(0, pos);
 }
 
-std::vector<std::string> tokenize(const std::string& str, const std::string& delimiters)
-{
-    std::vector<std::string> vect;
-    size_t last = str.find_first_not_of(delimiters, 0);
-    size_t pos = str.find_first_of(delimiters, last);
+bool next_line(string_span str, size_t& pos, string_span& line) {
+    if (pos >= str.length())
+        return false;
+
+    const char* found = static_cast<const char*>(std::memchr(str.data() + pos, '\n', str.length() - pos));
+    size_t end = (found == nullptr) ? str.length() : found - str.data();
+    line = str.substr(pos, end - pos);
+    pos = end + 1;
+    return true;
+}
+
+bool tokenizer::next(string_span& token) {
+    size_t last = str.find_first_not_of(delimiters, pos);
+    if (last == string_span::npos) {
+        pos = str.length();
+        return false;
+    }
+
+    pos = str.find_first_of(delimiters, last);
+    if (pos == string_span::npos)
+        pos = str.length();
+    token = str.substr(last, pos - last);
+    return true;
+}
+
+bool is_hex(string_span str) {
+    if (str.empty())
+        return false;
+    for (size_t i = 0; i < str.length(); i++) {
+        if (hex_digit(str[i]) < 0)
+            return false;
+    }
+    return true;
+}
+
+unsigned long hex_value(string_span str) {
+    unsigned long value = 0;
 
-    while (std::string::npos != pos || std::string::npos != last) {
-        vect.push_back(str.substr(last, pos - last));
-        last = str.find_first_not_of(delimiters, pos);
-        pos = str.find_first_of(delimiters, last);
+    for (size_t i = 0; i < str.length(); i++) {
+        int digit = hex_digit(str[i]);
+        value = (value << 4) | ((digit < 0) ? 0 : digit);
     }
-    return vect;
+    return value;
 }
@@ -4,9 +4,61 @@
  * License: TBD
  */
 
+#ifndef __STRING_OPERATIONS_H__
+#define __STRING_OPERATIONS_H__
+
 #include <string>
-#include <vector>
+#include <cstddef>
+
+/*
+ * Read only view of characters owned by other string. The view is valid only
+ * while the string is not modified or destroyed.
+ */
+class string_span {
+private:
+    const char* ptr;
+    size_t len;
+public:
+    static const size_t npos = std::string::npos;
+
+    string_span() : ptr(""), len(0) {}
+    string_span(const char* p, size_t l) : ptr(p), len(l) {}
+    string_span(const std::string& str) : ptr(str.data()), len(str.length()) {}
+
+    const char* data() const { return ptr; }
+    size_t length() const { return len; }
+    bool empty() const { return len == 0; }
+    char operator[](size_t i) const { return ptr[i]; }
+    std::string str() const { return std::string(ptr, len); }
+
+    string_span substr(size_t pos, size_t count = npos) const;
+    size_t find_first_of(const char* chars, size_t pos = 0) const;
+    size_t find_first_not_of(const char* chars, size_t pos = 0) const;
+    size_t find_last_not_of(const char* chars) const;
+};
+
+string_span trim(string_span str, const char* whitespace = " \t\r\n\v\f");
+string_span uncomment(string_span str);
+
+// Line starting at pos without line feed, pos is moved to the next line.
+// Returns false at the end of the string.
+bool next_line(string_span str, size_t& pos, string_span& line);
+
+// Splits string into non empty fields one by one
+class tokenizer {
+private:
+    string_span str;
+    const char* delimiters;
+    size_t pos;
+public:
+    tokenizer(string_span s, const char* d = ";") : str(s), delimiters(d), pos(0) {}
+    // Next field, returns false if there is no more field
+    bool next(string_span& token);
+};
+
+// Conversion of hexadecimal digits without locale
+bool is_hex(string_span str);
+// Value of hexadecimal number, invalid digits are taken as 0
+unsigned long hex_value(string_span str);
 
-std::string trim(const std::string& str, const std::string& whitespace = " \t\r\n");
-std::string uncomment(const std::string& str);
-std::vector<std::string> tokenize(const std::string& str, const std::string& delimiters = ";");
+#endif // __STRING_OPERATIONS_H__
@@ -0,0 +1,53 @@
+/*
+ * Constants of the TR programming protocol.
+ * Author: Vlastimil Kosar <kosar@rehivetrch.com>
+ * License: TBD
+ */
+
+#ifndef __TR_PROTOCOL_H__
+#define __TR_PROTOCOL_H__
+
+#include <cstddef>
+
+#include <TrException.h>
+#include <TrTypes.h>
+
+// Length, range and other constants
+static const size_t CFG_LEN                     = 32;
+static const unsigned char CFG_CHKSUM_INIT      = 0x5f;
+static const size_t RFPMG_LEN                   = 1;
+static const size_t ACCESS_PWD_LEN              = 16;
+static const size_t USER_KEY_LEN                = 16;
+static const size_t SPECIAL_LEN                 = 18;
+// Address of a block uploaded into flash or eeprom
+static const size_t ADDR_LEN                    = 2;
+
+inline TrTarget getMemoryTarget(TrMemory memory) {
+    switch(memory) {
+        case TrMemory::FLASH:
+            return TrTarget::FLASH;
+        case TrMemory::INTERNAL_EEPROM:
+            return TrTarget::INTERNAL_EEPROM;
+        case TrMemory::EXTERNAL_EEPROM:
+            return TrTarget::EXTERNAL_EEPROM;
+        default:
+            TR_THROW_EXCEPTION(TrException, "Invalid TR memory type!");
+            break;
+    }
+}
+
+inline TrMemory getTargetMemory(TrTarget target) {
+    switch(target) {
+        case TrTarget::FLASH:
+            return TrMemory::FLASH;
+        case TrTarget::INTERNAL_EEPROM:
+            return TrMemory::INTERNAL_EEPROM;
+        case TrTarget::EXTERNAL_EEPROM:
+            return TrMemory::EXTERNAL_EEPROM;
+        default:
+            TR_THROW_EXCEPTION(TrException, "Invalid TR memory target!");
+            break;
+    }
+}
+
+#endif // __TR_PROTOCOL_H__